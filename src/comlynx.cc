@@ -22,5 +22,3 @@
 // ------------------------------------------------------------------------------ 
 
 #include "comlynx.h"
-
-ComLynx::ReadReceipt ComLynx::ByteMessage::s_read_receipt_complete;
@@ -29,12 +29,22 @@
 #error Requires C++17.
 #endif
 
+#include <algorithm>
 #include <array>
+#include <bitset>
 #include <cassert>
 #include <chrono>
-#include <deque>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory_resource>
+#include <optional>
+#include <type_traits>
 #include <vector>
 
+#include "comlynx_stats.h"
+
 /// The Handy emulator uses this too and we want to live in it.
 #ifndef UBYTE
 #define UBYTE uint8_t
@@ -47,6 +57,12 @@
     std::abort();                                                 \
   }
 
+/// Set to 1 to have every bus keep a ComLynxStats (see GetStats()). It
+/// changes the layout of BasicComLynx, so every file in a program must agree.
+#ifndef COMLYNX_ENABLE_STATS
+#define COMLYNX_ENABLE_STATS 0
+#endif  // COMLYNX_ENABLE_STATS
+
 /// The checksum used by most ComLynx games (e.g. Slime World)
 constexpr inline UBYTE ComLynxCommonChecksum(
     std::initializer_list<UBYTE> const &bytes) {
@@ -72,17 +88,226 @@ constexpr inline bool CalculateParity(bool even_parity, UBYTE byte) {
   return (even_parity ? CalculateEvenParity(byte) : CalculateOddParity(byte));
 }
 
+/// A ComLynx frame: 1 start bit, 8 data bits, 1 parity bit and 1 stop bit.
+constexpr inline int kComLynxBitsPerFrame = 11;
+
+/// Host ticks needed to shift out one frame. The UART is clocked by Timer 4,
+/// which counts once every `ticks_per_timer4_clock` host ticks and reloads from
+/// `timer4_backup`; every bit takes 8 UART clocks.
+constexpr inline uint64_t ComLynxFrameTicks(UBYTE timer4_backup,
+                                            uint64_t ticks_per_timer4_clock) {
+  return ticks_per_timer4_clock * (timer4_backup + 1u) * 8u *
+         kComLynxBitsPerFrame;
+}
+
 /**
- * Class to replicate the Atari Lynx ComLynx UART.
+ * The bytes on the cable, oldest first, addressed by free-running sequence
+ * numbers so every reader can keep its own position in constant time.
+ *
+ * Stored as parallel arrays rather than one struct per byte: the payload, a
+ * parity bitset, the sender ID as `kSenderBits` bit planes (bit `k` of slot
+ * `i`'s sender is bit `i` of plane `k`), and a count of readers still to come.
+ * A full 32-byte backlog of that fits in two cache lines, and "did this player
+ * send anything still queued" is a handful of mask operations. The timestamps
+ * are only needed now and then, so they sit apart at the end.
  */
-class ComLynx {
+template <size_t kCapacity, int kSenderBits>
+class ComLynxByteQueue {
+  static_assert((kCapacity & (kCapacity - 1)) == 0,
+                "Capacity must be a power of two.");
+  static_assert(kCapacity <= 32, "Slots must fit in a 32-bit mask.");
+  static_assert(kSenderBits > 0 && kSenderBits <= 16, "Unsupported senders.");
+
  public:
-  using Clock = std::chrono::system_clock;
-  using TimePoint = Clock::time_point;
-  using Duration = Clock::duration;
-  using ReadReceipt = uint32_t;
+  using Index = uint32_t;
+  using Tick = uint64_t;
+  using Sender = int;
+  /// Wide enough to count every possible reader of a byte.
+  using Readers = std::conditional_t<kSenderBits <= 8, uint8_t, uint16_t>;
+
+  static constexpr Sender kMaxSenders = Sender{1} << kSenderBits;
+
+  constexpr inline bool empty() const {
+    return head_ == tail_;
+  }
+
+  constexpr inline size_t size() const {
+    return tail_ - head_;
+  }
+
+  constexpr inline bool full() const {
+    return size() == kCapacity;
+  }
+
+  /// Index of the oldest byte.
+  constexpr inline Index begin_index() const {
+    return head_;
+  }
+
+  /// Index the next byte will get.
+  constexpr inline Index end_index() const {
+    return tail_;
+  }
+
+  /// Appends a byte that `readers` players still have to read.
+  inline void push_back(Sender sender, UBYTE data, bool parity, Tick timestamp,
+                        Tick delivery, Readers readers) {
+    COMLYNX_ASSERT(!full());
+    COMLYNX_ASSERT(sender >= 0 && sender < kMaxSenders);
+
+    auto const slot = tail_ & kMask;
+    auto const bit = Bit(tail_);
+    data_[slot] = data;
+    readers_[slot] = readers;
+    parity_ = parity ? (parity_ | bit) : (parity_ & ~bit);
+    for (int k = 0; k < kSenderBits; ++k) {
+      auto &plane = sender_planes_[k];
+      plane = ((sender >> k) & 1) ? (plane | bit) : (plane & ~bit);
+    }
+    timestamps_[slot] = timestamp;
+    deliveries_[slot] = delivery;
+    ++tail_;
+  }
+
+  /// Appends `count` bytes from one sender in one go. Bit `k` of `parity` is
+  /// the parity of `data[k]`, and byte `k` is delivered at `first_delivery +
+  /// k * delivery_step`.
+  inline void append(Sender sender, UBYTE const *data, size_t count,
+                     uint32_t parity, Tick timestamp, Tick first_delivery,
+                     Tick delivery_step, Readers readers) {
+    COMLYNX_ASSERT(count <= kCapacity - size());
+    COMLYNX_ASSERT(sender >= 0 && sender < kMaxSenders);
+    if (count == 0) return;
+
+    // The new bytes may wrap around the end of the arrays.
+    auto const slot = tail_ & kMask;
+    auto const first = std::min(count, kCapacity - slot);
+    auto const second = count - first;
+    std::memcpy(&data_[slot], data, first);
+    std::memcpy(&data_[0], data + first, second);
+    std::fill_n(&readers_[slot], first, readers);
+    std::fill_n(&readers_[0], second, readers);
+    std::fill_n(&timestamps_[slot], first, timestamp);
+    std::fill_n(&timestamps_[0], second, timestamp);
+    for (size_t k = 0; k < count; ++k) {
+      deliveries_[(slot + k) & kMask] = first_delivery + k * delivery_step;
+    }
+
+    auto const run = Run(tail_, count);
+    parity_ = (parity_ & ~run) | (RotateLeft(parity, slot) & run);
+    for (int k = 0; k < kSenderBits; ++k) {
+      auto &plane = sender_planes_[k];
+      plane = ((sender >> k) & 1) ? (plane | run) : (plane & ~run);
+    }
+    tail_ += static_cast<Index>(count);
+  }
+
+  inline void pop_front() {
+    COMLYNX_ASSERT(!empty());
+    ++head_;
+  }
+
+  constexpr inline UBYTE data(Index index) const {
+    return data_[index & kMask];
+  }
+
+  constexpr inline bool parity(Index index) const {
+    return parity_ & Bit(index);
+  }
+
+  constexpr inline Sender sender(Index index) const {
+    Sender sender = 0;
+    for (int k = 0; k < kSenderBits; ++k) {
+      sender |= ((sender_planes_[k] & Bit(index)) ? 1 : 0) << k;
+    }
+    return sender;
+  }
+
+  constexpr inline Tick timestamp(Index index) const {
+    return timestamps_[index & kMask];
+  }
+
+  constexpr inline Tick delivery(Index index) const {
+    return deliveries_[index & kMask];
+  }
+
+  constexpr inline Readers readers(Index index) const {
+    return readers_[index & kMask];
+  }
+
+  /// One fewer player still has to read this byte.
+  inline void MarkRead(Index index) {
+    auto &readers = readers_[index & kMask];
+    COMLYNX_ASSERT(readers > 0);
+    --readers;
+  }
+
+  /// Whether any byte still queued came from `sender`.
+  constexpr inline bool HasFrom(Sender sender) const {
+    auto match = Occupied();
+    for (int k = 0; k < kSenderBits; ++k) {
+      auto const plane = sender_planes_[k];
+      match &= ((sender >> k) & 1) ? plane : ~plane;
+    }
+    return match != 0;
+  }
+
+ private:
+  using Bits = uint32_t;
+
+  static constexpr Index kMask = kCapacity - 1;
+
+  static constexpr inline Bits Bit(Index index) {
+    return Bits{1} << (index & kMask);
+  }
+
+  static constexpr inline Bits RotateLeft(Bits bits, Index shift) {
+    shift &= 31;
+    if (shift == 0) return bits;
+    return (bits << shift) | (bits >> (32 - shift));
+  }
+
+  /// `count` slots starting at `index`, as a mask.
+  static constexpr inline Bits Run(Index index, size_t count) {
+    if (count == 0) return 0;
+    if (count == 32) return ~Bits{0};
+    return RotateLeft((Bits{1} << count) - 1, index & kMask);
+  }
+
+  /// The slots between head and tail, as a mask.
+  constexpr inline Bits Occupied() const {
+    return Run(head_, size());
+  }
+
+  std::array<UBYTE, kCapacity> data_ = {};
+  std::array<Readers, kCapacity> readers_ = {};
+  Bits parity_ = {};
+  std::array<Bits, kSenderBits> sender_planes_ = {};
+  Index head_ = 0;
+  Index tail_ = 0;
+  std::array<Tick, kCapacity> timestamps_ = {};
+  std::array<Tick, kCapacity> deliveries_ = {};
+};
+
+/// Player count of a BasicComLynx that only learns it at run time.
+constexpr inline int kComLynxDynamicPlayers = 0;
+
+/**
+ * The types and limits every ComLynx flavour shares, so e.g.
+ * `ComLynx::ParityConfig` names the same type for all of them.
+ */
+struct ComLynxTypes {
+  /// Emulated time, in whatever unit the host counts cycles in.
+  using Tick = uint64_t;
   using Player = int;
 
+  /// More than this many unread bytes on the cable is an overrun.
+  static constexpr size_t kBufferSize = 32;
+
+  /// Bits used to store who sent a queued byte.
+  static constexpr int kSenderBits = 3;
+  static constexpr Player kMaxPlayers = Player{1} << kSenderBits;
+
   enum class ParityConfig {
     kOdd,
     kEven,
@@ -108,55 +333,124 @@ class ComLynx {
     }
   };
 
+  /// A copy of one byte on the cable.
   struct ByteMessage {
-    static ReadReceipt s_read_receipt_complete;
-    Player const sender;
-    TimePoint const time_point;
-    UBYTE const data;
-    bool const parity;
-    ReadReceipt read_receipt = {};
+    Player sender = {};
+    Tick timestamp = {};
+    Tick delivery = {};
+    UBYTE data = {};
+    bool parity = {};
+  };
 
-    ByteMessage(Player player, UBYTE data, bool parity)
-        : sender{player}
-        , data{data}
-        , time_point{Clock::now()}
-        , read_receipt{0}
-        , parity{parity} {
-      MarkRead(player);
-    }
+  using Buffer = ComLynxByteQueue<kBufferSize, kSenderBits>;
+  using Index = Buffer::Index;
+
+  /// Called whenever a player's IRQ line changes level.
+  using IRQCallback = void (*)(void *context, Player player, bool level);
+
+  /// One bit per player.
+  using PlayerMask = uint8_t;
+  static_assert(kMaxPlayers <= 8, "Players must fit in a PlayerMask.");
+
+  /**
+   * A bus's whole state in one fixed-size, trivially copyable block, so
+   * rollback netplay can keep a ring of them and save one every frame with a
+   * plain copy. See BasicComLynx::Snapshot().
+   */
+  struct SavedState {
+    Buffer buffer;
+    Tick now;
+    Tick frame_ticks;
+    Tick line_busy_until;
+    std::array<Index, kMaxPlayers> read_cursors;
+    std::array<Error, kMaxPlayers> errors;
+    PlayerMask breaks;
+    PlayerMask rx_int_en;
+    PlayerMask tx_int_en;
+    PlayerMask irq;
+    Player n_players;
+    bool configured;
+    bool enable_parity;
+    bool even_parity;
+  };
 
-    constexpr inline bool HasRead(Player player) const {
-      return (read_receipt & (1 << player));
-    }
+};
 
-    constexpr inline void MarkRead(Player player) {
-      read_receipt |= (1 << player);
-    }
+static_assert(std::is_trivially_copyable_v<ComLynxTypes::SavedState>,
+              "Saved states must be copyable with memcpy.");
 
-    inline bool AllHaveRead() const {
-      return read_receipt == s_read_receipt_complete;
-    }
+/**
+ * Class to replicate the Atari Lynx ComLynx UART.
+ *
+ * With `kPlayers` set, the player count is a compile-time constant and all
+ * per-player state lives inline in fixed arrays and bitsets. With
+ * kComLynxDynamicPlayers (the ComLynx alias) it is given at run time and the
+ * per-player state is allocated once, from a std::pmr resource.
+ */
+template <int kPlayers = kComLynxDynamicPlayers>
+class BasicComLynx : public ComLynxTypes {
+  static_assert(kPlayers >= 0 && kPlayers <= kMaxPlayers,
+                "Unsupported player count.");
 
-    constexpr inline void ResetRead() {
-      read_receipt = 0;
-    }
-  };
+ public:
+  static constexpr bool kIsDynamic = kPlayers == kComLynxDynamicPlayers;
+
+  /// Per-player state is allocated from `resource`, here and in Reset() only;
+  /// Send, Recv and the status calls never allocate. A fixed-size bus ignores
+  /// `resource` and only accepts `n_players == kPlayers`.
+  inline explicit BasicComLynx(
+      Player n_players = kPlayers,
+      std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+      : errors_(MakePlayerStorage<decltype(errors_)>(resource))
+      , breaks_(MakePlayerStorage<decltype(breaks_)>(resource))
+      , rx_int_en_(MakePlayerStorage<decltype(rx_int_en_)>(resource))
+      , tx_int_en_(MakePlayerStorage<decltype(tx_int_en_)>(resource))
+      , read_cursors_(MakePlayerStorage<decltype(read_cursors_)>(resource))
+      , irq_(MakePlayerStorage<decltype(irq_)>(resource))
+      , serctl_(MakePlayerStorage<decltype(serctl_)>(resource)) {
+    Reset(n_players);
+  }
 
-  using Buffer = std::deque<ByteMessage>;
+  /// Puts the bus back in its just-constructed state, keeping the memory it
+  /// already has so it can be reused without allocating.
+  inline void Reset(Player n_players) {
+    COMLYNX_ASSERT(n_players >= 0 && n_players <= kMaxPlayers);
+    COMLYNX_ASSERT(kIsDynamic || n_players == kPlayers);
+    n_players_ = n_players;
+    configured_ = false;
+    enable_parity_ = {};
+    even_parity_ = {};
+    now_ = {};
+    clock_ = nullptr;
+    frame_ticks_ = {};
+    line_busy_until_ = {};
+    buffer_ = {};
+    ResetPlayerStorage(errors_, n_players, Error{});
+    ResetPlayerStorage(breaks_, n_players, false);
+    ResetPlayerStorage(rx_int_en_, n_players, false);
+    ResetPlayerStorage(tx_int_en_, n_players, false);
+    ResetPlayerStorage(read_cursors_, n_players, Index{});
+    ResetPlayerStorage(irq_, n_players, false);
+    ResetPlayerStorage(serctl_, n_players, UBYTE{});
+    ResetStats();
+    MarkAllDirty();
+    irq_callback_ = nullptr;
+    irq_context_ = nullptr;
+  }
 
-  inline ComLynx(Player n_players)
-      : n_players_{n_players} {
-    ByteMessage::s_read_receipt_complete = (1u << n_players) - 1u;
-    errors_.resize(n_players);
-    breaks_.resize(n_players);
-    rx_int_en_.resize(n_players);
-    tx_int_en_.resize(n_players);
+  constexpr inline Player GetPlayerCount() const {
+    if constexpr (kIsDynamic) {
+      return n_players_;
+    } else {
+      return kPlayers;
+    }
   }
 
   constexpr void Configure(bool enable_parity, bool even_parity) {
     enable_parity_ = enable_parity;
     even_parity_ = even_parity;
     configured_ = true;
+    MarkAllDirty();
   }
 
   constexpr void Configure(ParityConfig config) {
@@ -176,17 +470,101 @@ class ComLynx {
     }
   }
 
-  constexpr inline void EnableRxIRQ(Player player, bool value) {
+  /// Sets the emulated time that newly sent bytes get stamped with.
+  inline void SetTime(Tick now) {
+    auto const before = Now();
+    now_ = now;
+    if (IsInFlightAt(before) || IsInFlightAt(now)) {
+      MarkAllDirty();
+      UpdateIRQs();
+    }
+  }
+
+  /// Lets the bus read the host's own cycle counter on every Send instead of
+  /// being told the time. Pass nullptr to go back to SetTime().
+  constexpr inline void AttachClock(Tick const *cycle_counter) {
+    clock_ = cycle_counter;
+  }
+
+  constexpr inline bool HasClock() const {
+    return clock_ != nullptr;
+  }
+
+  constexpr inline Tick Now() const {
+    return clock_ ? *clock_ : now_;
+  }
+
+  /// Moves the emulated time forward (only without an attached clock).
+  inline void Advance(Tick ticks) {
+    COMLYNX_ASSERT(!clock_);
+    auto const before = now_;
+    now_ += ticks;
+    if (IsInFlightAt(before)) {
+      MarkAllDirty();
+      UpdateIRQs();
+    }
+  }
+
+  /// Makes each byte take `frame_ticks` on the cable before the others can
+  /// read it, one byte after the other, like the real shift register does.
+  /// See ComLynxFrameTicks(). Zero (the default) delivers bytes immediately.
+  constexpr inline void ConfigureFrameTime(Tick frame_ticks) {
+    frame_ticks_ = frame_ticks;
+    MarkAllDirty();
+  }
+
+  constexpr inline Tick GetFrameTime() const {
+    return frame_ticks_;
+  }
+
+  constexpr inline bool IsTimed() const {
+    return frame_ticks_ != 0;
+  }
+
+  /// The time at which the next byte still in flight lands, so the host can
+  /// run straight up to it. Returns false if nothing is in flight.
+  inline bool NextDelivery(Tick &tick) const {
+    if (!IsTimed()) return false;
+
+    // Delivery times only ever go up, so find the first one in the future.
+    auto const now = Now();
+    auto first = buffer_.begin_index();
+    auto count = buffer_.end_index() - first;
+    while (count > 0) {
+      auto const half = count / 2;
+      if (buffer_.delivery(first + half) <= now) {
+        first += half + 1;
+        count -= half + 1;
+      } else {
+        count = half;
+      }
+    }
+    if (first == buffer_.end_index()) return false;
+
+    tick = buffer_.delivery(first);
+    return true;
+  }
+
+  /// Lets the host hear about IRQ edges instead of polling IsIRQ(). The
+  /// callback runs from inside whichever call caused the change.
+  constexpr inline void SetIRQCallback(IRQCallback callback, void *context) {
+    irq_callback_ = callback;
+    irq_context_ = context;
+  }
+
+  inline void EnableRxIRQ(Player player, bool value) {
     COMLYNX_ASSERT(configured_);
     rx_int_en_[player] = value;
+    UpdateIRQ(player);
   }
 
-  constexpr inline void EnableTxIRQ(Player player, bool value) {
+  inline void EnableTxIRQ(Player player, bool value) {
     COMLYNX_ASSERT(configured_);
     tx_int_en_[player] = value;
+    UpdateIRQ(player);
   }
 
-  constexpr inline bool Send(Player player, UBYTE data) {
+  inline bool Send(Player player, UBYTE data) {
     COMLYNX_ASSERT(configured_);
     TxNotReadyReason reason = TxNotReadyReason::kNone;
     if (!IsTxReady(player, reason)) {
@@ -201,10 +579,28 @@ class ComLynx {
           errors_[player].overrun = true;
           break;
       }
+      CountTxError(player, reason);
+      MarkDirty(player);
       return false;
     }
 
-    buffer_.emplace_back(player, data, ParityFor(data));
+    auto const now = Now();
+    auto delivery = now;
+    if (IsTimed()) {
+      // The cable carries one frame at a time.
+      delivery = std::max(now, line_busy_until_) + frame_ticks_;
+      line_busy_until_ = delivery;
+    }
+    buffer_.push_back(player, data, ParityFor(data), now, delivery,
+                      static_cast<Buffer::Readers>(GetPlayerCount() - 1));
+    CountSent(player, 1);
+
+    // The sender has already "read" its own byte, so it only has to step over
+    // it if it was caught up.
+    SkipOwnMessages(player);
+    FreeRead();
+    MarkAllDirty();
+    UpdateIRQs();
     return true;
   }
 
@@ -212,55 +608,129 @@ class ComLynx {
     COMLYNX_ASSERT(configured_);
     COMLYNX_ASSERT(!buffer_.empty());
 
-    auto msg_ptr = FirstUnreadMessage(player);
-    COMLYNX_ASSERT(msg_ptr);
+    auto &cursor = read_cursors_[player];
+    COMLYNX_ASSERT(IsReadable(cursor));
 
     // Mark as read and return for this player.
-    auto &curr_msg = *msg_ptr;
-    COMLYNX_ASSERT(!curr_msg.HasRead(player));
-    curr_msg.MarkRead(player);
+    auto const data = buffer_.data(cursor);
+    CountReceived(player, cursor);
+    buffer_.MarkRead(cursor);
+    ++cursor;
+    SkipOwnMessages(player);
+    FreeRead();
+    MarkAllDirty();
+    UpdateIRQs();
+
+    return data;
+  }
 
-    // If this was the last reader.
-    if (buffer_.front().AllHaveRead()) {
-      buffer_.pop_front();
+  /**
+   * Sends up to `size` bytes in one go, as if by that many Send() calls:
+   * whatever does not fit on the cable is dropped and flags an overrun.
+   * Returns how many bytes went out.
+   */
+  inline size_t SendBurst(Player player, UBYTE const *data, size_t size) {
+    COMLYNX_ASSERT(configured_);
+    auto const count = std::min(size, kBufferSize - buffer_.size());
+    if (count < size) {
+      errors_[player].overrun = true;
+      CountTxError(player, TxNotReadyReason::kOverrun);
+      MarkDirty(player);
+    }
+    if (count == 0) return 0;
+
+    uint32_t parity = 0;
+    for (size_t k = 0; k < count; ++k) {
+      parity |= uint32_t{ParityFor(data[k])} << k;
     }
 
-    return curr_msg.data;
+    auto const now = Now();
+    auto first_delivery = now;
+    if (IsTimed()) {
+      first_delivery = std::max(now, line_busy_until_) + frame_ticks_;
+      line_busy_until_ = first_delivery + (count - 1) * frame_ticks_;
+    }
+    buffer_.append(player, data, count, parity, now, first_delivery,
+                   frame_ticks_,
+                   static_cast<Buffer::Readers>(GetPlayerCount() - 1));
+    CountSent(player, count);
+
+    SkipOwnMessages(player);
+    FreeRead();
+    MarkAllDirty();
+    UpdateIRQs();
+    return count;
   }
 
-  constexpr inline void SendBreak() {
+  /**
+   * Reads everything the player can read right now, up to `capacity` bytes,
+   * as if by IsRxReady() and Recv() in a loop, parity errors included.
+   * Returns how many bytes were read.
+   */
+  inline size_t RecvAvailable(Player player, UBYTE *out, size_t capacity) {
+    COMLYNX_ASSERT(configured_);
+
+    auto &cursor = read_cursors_[player];
+    size_t count = 0;
+    bool parity_error = false;
+    while (count < capacity && IsReadable(cursor)) {
+      auto const data = buffer_.data(cursor);
+      parity_error |=
+          buffer_.parity(cursor) != CalculateParity(even_parity_, data);
+      out[count++] = data;
+      CountReceived(player, cursor);
+      buffer_.MarkRead(cursor);
+      ++cursor;
+      SkipOwnMessages(player);
+    }
+    if (count == 0) return 0;
+
+    if (parity_error) errors_[player].parity = true;
+    FreeRead();
+    MarkAllDirty();
+    UpdateIRQs();
+    return count;
+  }
+
+  inline void SendBreak() {
     COMLYNX_ASSERT(configured_);
 
     // TODO: maybe not set it for the player themselves?
 
-    for (size_t i = 0u; i < n_players_; ++i) {
+    for (Player i = 0; i < GetPlayerCount(); ++i) {
       breaks_[i] = true;
     }
+    CountBreak();
+    MarkAllDirty();
   }
 
   /// Player can only read when something new is available.
   inline bool IsRxReady(Player player) {
     COMLYNX_ASSERT(configured_);
 
-    auto msg_ptr = FirstUnreadMessage(player);
-    if (nullptr == msg_ptr) {
+    auto const cursor = read_cursors_[player];
+    if (!IsReadable(cursor)) {
       return false;
     }
-    if (msg_ptr->parity != CalculateParity(even_parity_, msg_ptr->data)) {
+    if (buffer_.parity(cursor) !=
+            CalculateParity(even_parity_, buffer_.data(cursor)) &&
+        !errors_[player].parity) {
       errors_[player].parity = true;
+      MarkDirty(player);
     }
     return true;
   }
 
-  inline ByteMessage *FirstUnreadMessage(Player player) {
+  inline std::optional<ByteMessage> FirstUnreadMessage(Player player) const {
     COMLYNX_ASSERT(configured_);
 
-    for (auto &msg : buffer_) {
-      if (!msg.HasRead(player)) {
-        return &msg;
-      }
+    auto const cursor = read_cursors_[player];
+    if (!IsReadable(cursor)) {
+      return std::nullopt;
     }
-    return nullptr;
+    return ByteMessage{buffer_.sender(cursor), buffer_.timestamp(cursor),
+                       buffer_.delivery(cursor), buffer_.data(cursor),
+                       buffer_.parity(cursor)};
   }
 
   /// Player can only write after everything has been read.
@@ -270,7 +740,7 @@ class ComLynx {
     auto const len = buffer_.size();
     if (len == 0) return true;
 
-    if (len >= 32) {
+    if (len >= kBufferSize) {
       reason = TxNotReadyReason::kOverrun;
       return false;
     }
@@ -280,51 +750,70 @@ class ComLynx {
 
   inline bool IsTxEmpty(Player player) const {
     COMLYNX_ASSERT(configured_);
+    return !buffer_.HasFrom(player);
+  }
 
-    for (auto const &msg : buffer_) {
-      if (msg.sender == player) {
-        return false;
-      }
-    }
+  /// Bytes on the cable that someone has yet to read.
+  inline size_t GetQueuedCount() const {
+    return buffer_.size();
+  }
+
+  using Stats = ComLynxStats<kIsDynamic ? kMaxPlayers : kPlayers>;
+
+  /// Copies out what the bus counted since it was last reset. Returns false,
+  /// and counts nothing at all, unless built with COMLYNX_ENABLE_STATS.
+  inline bool GetStats(Stats &stats) const {
+#if COMLYNX_ENABLE_STATS
+    stats = stats_;
+    stats.n_players = GetPlayerCount();
     return true;
+#else
+    (void)stats;
+    return false;
+#endif  // COMLYNX_ENABLE_STATS
+  }
+
+  /// Starts counting again from zero. Reset() does this too; Restore() and
+  /// Deserialize() do not, the counts are about the host, not the bus.
+  inline void ResetStats() {
+#if COMLYNX_ENABLE_STATS
+    stats_ = {};
+#endif  // COMLYNX_ENABLE_STATS
   }
 
   inline bool IsRxBrk(Player player) {
     COMLYNX_ASSERT(configured_);
     if (breaks_[player]) {
       breaks_[player] = false;
+      MarkDirty(player);
       return true;
     }
     return false;
   }
 
+  /// The level of the player's IRQ line, kept up to date as the bus changes.
   inline bool IsIRQ(Player player) {
-    if (rx_int_en_[player] && IsRxReady(player)) {
-      return true;
-    }
-    TxNotReadyReason reason = {};
-    if (tx_int_en_[player] && IsTxReady(player, reason)) {
-      return true;
-    }
-    return false;
+    // Nobody tells us when an attached clock moves on.
+    if (clock_ && IsTimed()) UpdateIRQ(player);
+    return irq_[player];
   }
 
-  constexpr inline bool HasFrameError(Player player) const {
+  inline bool HasFrameError(Player player) const {
     COMLYNX_ASSERT(configured_);
     return errors_[player].frame;
   }
 
-  constexpr inline bool HasOverrunError(Player player) const {
+  inline bool HasOverrunError(Player player) const {
     COMLYNX_ASSERT(configured_);
     return errors_[player].overrun;
   }
 
-  constexpr inline bool HasParityError(Player player) const {
+  inline bool HasParityError(Player player) const {
     COMLYNX_ASSERT(configured_);
     return errors_[player].parity;
   }
 
-  constexpr inline bool HasAnyError(Player player) const {
+  inline bool HasAnyError(Player player) const {
     COMLYNX_ASSERT(configured_);
     if (HasFrameError(player)) return true;
     if (HasOverrunError(player)) return true;
@@ -332,42 +821,423 @@ class ComLynx {
     return false;
   }
 
-  constexpr inline void ResetErrors(Player player) {
+  inline void ResetErrors(Player player) {
     COMLYNX_ASSERT(configured_);
     errors_[player].Reset();
+    MarkDirty(player);
   }
 
-  constexpr inline UBYTE GetSERCTL(Player player) {
+  /// The packed status register. Only rebuilt after something changed it, so
+  /// busy-waiting on it is a single load.
+  inline UBYTE GetSERCTL(Player player) {
     COMLYNX_ASSERT(configured_);
 
-    TxNotReadyReason reason = {};
-    auto const tx_ready = IsTxReady(player, reason);
-    auto const rx_ready = IsRxReady(player);
-    auto const tx_empty = IsTxEmpty(player);
-    auto const &errors = errors_[player];
-    auto const parity_bit = GetParityOfNextByte(player);
+    // Nobody tells us when an attached clock moves on.
+    auto const bit = 1u << player;
+    if ((serctl_dirty_ & bit) || (clock_ && IsTimed())) {
+      serctl_[player] = ComputeSERCTL(player);
+      serctl_dirty_ &= ~bit;
+    }
+    return serctl_[player];
+  }
 
-    return PackSERCTL(tx_ready, rx_ready, tx_empty, errors.parity,
-                      errors.overrun, errors.frame, breaks_[player],
-                      parity_bit);
+  /**
+   * Goes up whenever anything the status calls report may have changed: a
+   * byte sent or read, a break, errors, configuration, an IRQ line, or time
+   * moving on while bytes are in flight. A host that remembers the value
+   * from its last look can skip polling every player while it stands still.
+   *
+   * An attached clock moves on without telling the bus, so on a timed bus
+   * with one, also look again once NextDelivery() has passed.
+   */
+  constexpr inline uint64_t GetGeneration() const {
+    return generation_;
+  }
+
+  /// Saves the bus into `state` without allocating. The attached clock and
+  /// the IRQ callback are the host's wiring, not bus state, and are left out.
+  inline void Snapshot(SavedState &state) const {
+    state.buffer = buffer_;
+    state.now = now_;
+    state.frame_ticks = frame_ticks_;
+    state.line_busy_until = line_busy_until_;
+    state.breaks = {};
+    state.rx_int_en = {};
+    state.tx_int_en = {};
+    state.irq = {};
+    for (Player i = 0; i < kMaxPlayers; ++i) {
+      auto const present = i < GetPlayerCount();
+      state.read_cursors[i] = present ? read_cursors_[i] : Index{};
+      state.errors[i] = present ? errors_[i] : Error{};
+      if (!present) continue;
+      auto const bit = PlayerMask(1u << i);
+      state.breaks |= breaks_[i] ? bit : 0;
+      state.rx_int_en |= rx_int_en_[i] ? bit : 0;
+      state.tx_int_en |= tx_int_en_[i] ? bit : 0;
+      state.irq |= irq_[i] ? bit : 0;
+    }
+    state.n_players = GetPlayerCount();
+    state.configured = configured_;
+    state.enable_parity = enable_parity_;
+    state.even_parity = even_parity_;
+  }
+
+  /// Puts the bus back the way it was when `state` was saved. The player
+  /// count must match, and IRQ lines jump to their saved levels without
+  /// calling the IRQ callback.
+  inline void Restore(SavedState const &state) {
+    COMLYNX_ASSERT(state.n_players == GetPlayerCount());
+    buffer_ = state.buffer;
+    now_ = state.now;
+    frame_ticks_ = state.frame_ticks;
+    line_busy_until_ = state.line_busy_until;
+    for (Player i = 0; i < GetPlayerCount(); ++i) {
+      auto const bit = PlayerMask(1u << i);
+      read_cursors_[i] = state.read_cursors[i];
+      errors_[i] = state.errors[i];
+      breaks_[i] = state.breaks & bit;
+      rx_int_en_[i] = state.rx_int_en & bit;
+      tx_int_en_[i] = state.tx_int_en & bit;
+      irq_[i] = state.irq & bit;
+    }
+    configured_ = state.configured;
+    enable_parity_ = state.enable_parity;
+    even_parity_ = state.even_parity;
+    MarkAllDirty();
+  }
+
+  /// Version of the format Serialize() writes.
+  static constexpr UBYTE kSerializeVersion = 1;
+
+  /// Longest LEB128 encoding of a 64-bit number.
+  static constexpr size_t kMaxVarintSize = 10;
+
+  /// Room for the largest state Serialize() can write: header, times,
+  /// players, queue count, queued bytes.
+  static constexpr size_t kMaxSerializedSize =
+      6 + 3 * kMaxVarintSize + 2 * kMaxPlayers + 1 +
+      kBufferSize * (3 + 2 * kMaxVarintSize);
+
+  /**
+   * Writes the bus state in a compact, versioned, byte-order independent
+   * format for the host's save-states. Returns the number of bytes written,
+   * or 0 if `capacity` is too small. An idle 8-player bus takes about 30.
+   *
+   * Layout (numbers are LEB128 varints, signed ones zigzagged):
+   *   "CLS" version players flags now frame_ticks line_busy_until
+   *   per player: status bits, cursor (bytes past the oldest queued one)
+   *   count, then per queued byte:
+   *     data, sender | parity << 7, readers, timestamp - now,
+   *     delivery - timestamp
+   */
+  inline size_t Serialize(UBYTE *out, size_t capacity) const {
+    SavedState state;
+    Snapshot(state);
+
+    ByteWriter writer{out, out + capacity};
+    writer.Put('C');
+    writer.Put('L');
+    writer.Put('S');
+    writer.Put(kSerializeVersion);
+    writer.Put(static_cast<UBYTE>(state.n_players));
+    writer.Put((state.configured ? 0x01 : 0) | (state.enable_parity ? 0x02 : 0) |
+               (state.even_parity ? 0x04 : 0));
+    writer.PutVarint(state.now);
+    writer.PutVarint(state.frame_ticks);
+    writer.PutVarint(state.line_busy_until);
+
+    auto const &buffer = state.buffer;
+    auto const head = buffer.begin_index();
+    for (Player i = 0; i < state.n_players; ++i) {
+      auto const bit = PlayerMask(1u << i);
+      auto const &errors = state.errors[i];
+      UBYTE bits = {};
+      bits |= errors.overrun ? 0x01 : 0;
+      bits |= errors.parity ? 0x02 : 0;
+      bits |= errors.frame ? 0x04 : 0;
+      bits |= (state.breaks & bit) ? 0x08 : 0;
+      bits |= (state.rx_int_en & bit) ? 0x10 : 0;
+      bits |= (state.tx_int_en & bit) ? 0x20 : 0;
+      bits |= (state.irq & bit) ? 0x40 : 0;
+      writer.Put(bits);
+      writer.Put(static_cast<UBYTE>(state.read_cursors[i] - head));
+    }
+
+    writer.Put(static_cast<UBYTE>(buffer.size()));
+    for (auto i = head; i != buffer.end_index(); ++i) {
+      writer.Put(buffer.data(i));
+      writer.Put(static_cast<UBYTE>(buffer.sender(i) |
+                                    (buffer.parity(i) ? 0x80 : 0)));
+      writer.Put(buffer.readers(i));
+      writer.PutSignedVarint(
+          static_cast<int64_t>(buffer.timestamp(i) - state.now));
+      writer.PutVarint(buffer.delivery(i) - buffer.timestamp(i));
+    }
+
+    return writer.ok ? static_cast<size_t>(writer.pos - out) : 0;
+  }
+
+  /// Loads what Serialize() wrote. Returns false, leaving the bus as it was,
+  /// if the data is damaged, from a newer version, or for another player
+  /// count. Like Restore(), it does not call the IRQ callback.
+  inline bool Deserialize(UBYTE const *data, size_t size) {
+    ByteReader reader{data, data + size};
+    if (reader.Get() != 'C' || reader.Get() != 'L' || reader.Get() != 'S' ||
+        reader.Get() != kSerializeVersion) {
+      return false;
+    }
+
+    SavedState state = {};
+    state.n_players = reader.Get();
+    if (!reader.ok || state.n_players != GetPlayerCount()) return false;
+    auto const flags = reader.Get();
+    state.configured = flags & 0x01;
+    state.enable_parity = flags & 0x02;
+    state.even_parity = flags & 0x04;
+    state.now = reader.GetVarint();
+    state.frame_ticks = reader.GetVarint();
+    state.line_busy_until = reader.GetVarint();
+
+    for (Player i = 0; i < state.n_players; ++i) {
+      auto const bit = PlayerMask(1u << i);
+      auto const bits = reader.Get();
+      auto &errors = state.errors[i];
+      errors.overrun = bits & 0x01;
+      errors.parity = bits & 0x02;
+      errors.frame = bits & 0x04;
+      state.breaks |= (bits & 0x08) ? bit : 0;
+      state.rx_int_en |= (bits & 0x10) ? bit : 0;
+      state.tx_int_en |= (bits & 0x20) ? bit : 0;
+      state.irq |= (bits & 0x40) ? bit : 0;
+      state.read_cursors[i] = reader.Get();
+    }
+
+    auto const count = reader.Get();
+    if (!reader.ok || count > kBufferSize) return false;
+    for (Player i = 0; i < state.n_players; ++i) {
+      if (state.read_cursors[i] > count) return false;
+    }
+    for (size_t i = 0; i < count; ++i) {
+      auto const byte = reader.Get();
+      auto const meta = reader.Get();
+      auto const readers = reader.Get();
+      auto const timestamp = state.now + reader.GetSignedVarint();
+      auto const delivery = timestamp + reader.GetVarint();
+      auto const sender = Player{meta & 0x7F};
+      if (!reader.ok || sender >= state.n_players) return false;
+
+      // The reader count has to be the players still before this byte, and
+      // nobody can be waiting on a byte of their own.
+      Player expected = 0;
+      for (Player p = 0; p < state.n_players; ++p) {
+        if (state.read_cursors[p] > i) continue;
+        if (p == sender) {
+          if (state.read_cursors[p] == i) return false;
+          continue;
+        }
+        ++expected;
+      }
+      if (readers != expected) return false;
+      state.buffer.push_back(sender, byte, meta & 0x80, timestamp, delivery,
+                             static_cast<Buffer::Readers>(readers));
+    }
+    if (!reader.ok || reader.pos != reader.end) return false;
+
+    Restore(state);
+    return true;
   }
 
  private:
-  int const n_players_;
+  int n_players_ = {};
   bool configured_ = false;
   bool enable_parity_ = {};
   bool even_parity_ = {};
+  Tick now_ = {};
+  Tick const *clock_ = nullptr;
+  Tick frame_ticks_ = {};
+  Tick line_busy_until_ = {};
   Buffer buffer_;
-  std::vector<Error> errors_;
-  std::vector<bool> breaks_;
-  std::vector<bool> rx_int_en_;
-  std::vector<bool> tx_int_en_;
+  template <typename T>
+  using PlayerArray = std::conditional_t<kIsDynamic, std::pmr::vector<T>,
+                                         std::array<T, kPlayers>>;
+  using PlayerBits = std::conditional_t<kIsDynamic, std::pmr::vector<bool>,
+                                        std::bitset<kPlayers>>;
+
+  PlayerArray<Error> errors_;
+  PlayerBits breaks_;
+  PlayerBits rx_int_en_;
+  PlayerBits tx_int_en_;
+  PlayerArray<Index> read_cursors_;
+  PlayerBits irq_;
+  PlayerArray<UBYTE> serctl_;
+  uint32_t serctl_dirty_ = {};
+  /// Never reset, so a host's last-seen value can't match by accident.
+  uint64_t generation_ = {};
+  IRQCallback irq_callback_ = nullptr;
+  void *irq_context_ = nullptr;
+#if COMLYNX_ENABLE_STATS
+  Stats stats_;
+#endif  // COMLYNX_ENABLE_STATS
 
   constexpr inline bool ParityFor(UBYTE byte) const {
     return (enable_parity_ ? CalculateParity(even_parity_, byte)
                            : even_parity_);
   }
 
+  template <typename Storage>
+  static inline Storage MakePlayerStorage(
+      std::pmr::memory_resource *resource) {
+    if constexpr (kIsDynamic) {
+      return Storage(resource);
+    } else {
+      return Storage{};
+    }
+  }
+
+  template <typename T, typename Value>
+  static inline void ResetPlayerStorage(std::pmr::vector<T> &storage,
+                                        Player n_players, Value value) {
+    storage.assign(n_players, value);
+  }
+
+  template <typename T, size_t N, typename Value>
+  static inline void ResetPlayerStorage(std::array<T, N> &storage, Player,
+                                        Value value) {
+    storage.fill(value);
+  }
+
+  template <size_t N>
+  static inline void ResetPlayerStorage(std::bitset<N> &storage, Player,
+                                        bool value) {
+    value ? storage.set() : storage.reset();
+  }
+
+  // The hooks below compile to nothing without COMLYNX_ENABLE_STATS.
+
+  inline void CountSent(Player player, size_t count) {
+#if COMLYNX_ENABLE_STATS
+    stats_.players[player].bytes_sent += count;
+    stats_.queue_high_water = std::max(stats_.queue_high_water, buffer_.size());
+#else
+    (void)player, (void)count;
+#endif  // COMLYNX_ENABLE_STATS
+  }
+
+  /// Before `cursor` is marked read by `player`.
+  inline void CountReceived(Player player, Index cursor) {
+#if COMLYNX_ENABLE_STATS
+    auto &stats = stats_.players[player];
+    ++stats.bytes_received;
+    if (buffer_.parity(cursor) !=
+        CalculateParity(even_parity_, buffer_.data(cursor))) {
+      ++stats.parity_errors;
+    }
+    // Time may have been set back since; count that as no wait at all.
+    auto const sent = buffer_.timestamp(cursor);
+    stats.latency.Record(Now() > sent ? Now() - sent : 0);
+#else
+    (void)player, (void)cursor;
+#endif  // COMLYNX_ENABLE_STATS
+  }
+
+  inline void CountTxError(Player player, TxNotReadyReason reason) {
+#if COMLYNX_ENABLE_STATS
+    auto &stats = stats_.players[player];
+    if (reason == TxNotReadyReason::kFrame) ++stats.frame_errors;
+    if (reason == TxNotReadyReason::kOverrun) ++stats.overrun_errors;
+#else
+    (void)player, (void)reason;
+#endif  // COMLYNX_ENABLE_STATS
+  }
+
+  inline void CountBreak() {
+#if COMLYNX_ENABLE_STATS
+    ++stats_.breaks;
+#endif  // COMLYNX_ENABLE_STATS
+  }
+
+  constexpr inline void MarkDirty(Player player) {
+    serctl_dirty_ |= 1u << player;
+    ++generation_;
+  }
+
+  constexpr inline void MarkAllDirty() {
+    serctl_dirty_ = ~0u;
+    ++generation_;
+  }
+
+  /// Bounds-checked output for Serialize(); `ok` drops once it runs out.
+  struct ByteWriter {
+    UBYTE *pos;
+    UBYTE *end;
+    bool ok = true;
+
+    inline void Put(UBYTE byte) {
+      if (pos == end) {
+        ok = false;
+        return;
+      }
+      *pos++ = byte;
+    }
+
+    inline void PutVarint(uint64_t value) {
+      while (value >= 0x80) {
+        Put(static_cast<UBYTE>(value | 0x80));
+        value >>= 7;
+      }
+      Put(static_cast<UBYTE>(value));
+    }
+
+    inline void PutSignedVarint(int64_t value) {
+      PutVarint((static_cast<uint64_t>(value) << 1) ^
+                static_cast<uint64_t>(value >> 63));
+    }
+  };
+
+  /// Bounds-checked input for Deserialize(); reads zeros once it runs out.
+  struct ByteReader {
+    UBYTE const *pos;
+    UBYTE const *end;
+    bool ok = true;
+
+    inline UBYTE Get() {
+      if (pos == end) {
+        ok = false;
+        return 0;
+      }
+      return *pos++;
+    }
+
+    inline uint64_t GetVarint() {
+      uint64_t value = 0;
+      for (int shift = 0; shift < 64; shift += 7) {
+        auto const byte = Get();
+        value |= uint64_t{byte & 0x7Fu} << shift;
+        if (!(byte & 0x80)) return value;
+      }
+      ok = false;
+      return 0;
+    }
+
+    inline int64_t GetSignedVarint() {
+      auto const value = GetVarint();
+      return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+  };
+
+  inline UBYTE ComputeSERCTL(Player player) {
+    TxNotReadyReason reason = {};
+    auto const tx_ready = IsTxReady(player, reason);
+    auto const rx_ready = IsRxReady(player);
+    auto const tx_empty = IsTxEmpty(player);
+    auto const &errors = errors_[player];
+    auto const parity_bit = GetParityOfNextByte(player);
+
+    return PackSERCTL(tx_ready, rx_ready, tx_empty, errors.parity,
+                      errors.overrun, errors.frame, breaks_[player],
+                      parity_bit);
+  }
+
   constexpr inline UBYTE PackSERCTL(bool tx_ready, bool rx_ready, bool tx_empty,
                                     bool parity_err, bool overrun_err,
                                     bool frame_err, bool rx_break,
@@ -384,17 +1254,65 @@ class ComLynx {
     return byte;
   }
 
+  /// Whether a byte is still on its way at `tick`, so time passing matters.
+  inline bool IsInFlightAt(Tick tick) const {
+    return IsTimed() && !buffer_.empty() &&
+           buffer_.delivery(buffer_.end_index() - 1) > tick;
+  }
+
+  /// Whether there is a byte at `cursor` that has arrived.
+  constexpr inline bool IsReadable(Index cursor) const {
+    if (cursor == buffer_.end_index()) return false;
+    return !IsTimed() || buffer_.delivery(cursor) <= Now();
+  }
+
+  /// Keeps a player's cursor off the bytes it sent itself, so it always points
+  /// at its next unread byte (or the end of the buffer).
+  inline void SkipOwnMessages(Player player) {
+    auto &cursor = read_cursors_[player];
+    while (cursor != buffer_.end_index() && buffer_.sender(cursor) == player) {
+      ++cursor;
+    }
+  }
+
+  inline void UpdateIRQ(Player player) {
+    TxNotReadyReason reason = {};
+    auto const level =
+        (rx_int_en_[player] && IsReadable(read_cursors_[player])) ||
+        (tx_int_en_[player] && IsTxReady(player, reason));
+    if (level == irq_[player]) return;
+
+    irq_[player] = level;
+    ++generation_;
+    if (irq_callback_) {
+      irq_callback_(irq_context_, player, level);
+    }
+  }
+
+  inline void UpdateIRQs() {
+    if (!configured_) return;
+    for (Player i = 0; i < GetPlayerCount(); ++i) {
+      UpdateIRQ(i);
+    }
+  }
+
+  /// Frees every byte at the front that nobody still has to read.
+  inline void FreeRead() {
+    while (!buffer_.empty() && buffer_.readers(buffer_.begin_index()) == 0) {
+      buffer_.pop_front();
+    }
+  }
+
   inline bool PeekNextByte(Player player, UBYTE &byte) const {
-    for (const auto &msg : buffer_) {
-      if (!msg.HasRead(player)) {
-        byte = msg.data;
-        return true;
-      }
+    auto const cursor = read_cursors_[player];
+    if (!IsReadable(cursor)) {
+      return false;
     }
-    return false;
+    byte = buffer_.data(cursor);
+    return true;
   }
 
-  constexpr inline bool GetParityOfNextByte(Player player) const {
+  inline bool GetParityOfNextByte(Player player) const {
     // TODO: maybe it just be of the previous byte
 
     UBYTE byte = 0;
@@ -405,9 +1323,17 @@ class ComLynx {
   }
 };
 
-class ComLynxClient {
+/**
+ * One Lynx's end of the cable. Works with any bus that offers the ComLynx
+ * per-player interface (see ConcurrentComLynx).
+ */
+template <typename Bus>
+class BasicComLynxClient {
  public:
-  ComLynxClient(ComLynx &comlynx, ComLynx::Player player)
+  using Player = typename Bus::Player;
+  using TxNotReadyReason = typename Bus::TxNotReadyReason;
+
+  BasicComLynxClient(Bus &comlynx, Player player)
       : comlynx_{comlynx}
       , player_{player} {}
 
@@ -415,33 +1341,41 @@ class ComLynxClient {
     comlynx_.Configure(enable_parity, even_parity);
   }
 
-  constexpr inline void EnableRxIRQ(bool value) {
+  inline void EnableRxIRQ(bool value) {
     comlynx_.EnableRxIRQ(player_, value);
   }
 
-  constexpr inline void EnableTxIRQ(bool value) {
+  inline void EnableTxIRQ(bool value) {
     comlynx_.EnableTxIRQ(player_, value);
   }
 
-  constexpr inline bool Send(UBYTE data) {
+  inline bool Send(UBYTE data) {
     return comlynx_.Send(player_, data);
   }
 
-  constexpr inline UBYTE Recv() {
+  inline UBYTE Recv() {
     return comlynx_.Recv(player_);
   }
 
-  constexpr inline void SendBreak() {
+  inline size_t SendBurst(UBYTE const *data, size_t size) {
+    return comlynx_.SendBurst(player_, data, size);
+  }
+
+  inline size_t RecvAvailable(UBYTE *out, size_t capacity) {
+    return comlynx_.RecvAvailable(player_, out, capacity);
+  }
+
+  inline void SendBreak() {
     comlynx_.SendBreak();
   }
 
   /// Player can only read when something new is available.
-  constexpr inline bool IsRxReady() {
+  inline bool IsRxReady() {
     return comlynx_.IsRxReady(player_);
   }
 
   /// Player can only write after everything has been read.
-  inline bool IsTxReady(ComLynx::TxNotReadyReason &reason) const {
+  inline bool IsTxReady(TxNotReadyReason &reason) const {
     return comlynx_.IsTxReady(player_, reason);
   }
 
@@ -457,37 +1391,68 @@ class ComLynxClient {
     return comlynx_.IsIRQ(player_);
   }
 
-  constexpr inline bool HasFrameError() const {
+  inline bool HasFrameError() const {
     return comlynx_.HasFrameError(player_);
   }
 
-  constexpr inline bool HasOverrunError() const {
+  inline bool HasOverrunError() const {
     return comlynx_.HasOverrunError(player_);
   }
 
-  constexpr inline bool HasParityError() const {
+  inline bool HasParityError() const {
     return comlynx_.HasParityError(player_);
   }
 
-  constexpr inline bool HasAnyError() const {
+  inline bool HasAnyError() const {
     return comlynx_.HasAnyError(player_);
   }
 
-  constexpr inline void ResetErrors() {
+  inline void ResetErrors() {
     comlynx_.ResetErrors(player_);
   }
 
-  constexpr inline UBYTE GetSERCTL() {
+  inline UBYTE GetSERCTL() {
     return comlynx_.GetSERCTL(player_);
   }
 
-  constexpr inline ComLynx::Player GetPlayer() const {
+  inline size_t GetQueuedCount() const {
+    return comlynx_.GetQueuedCount();
+  }
+
+  /// See ConcurrentComLynx::WaitRx().
+  template <typename Rep, typename Period>
+  inline bool WaitRx(std::chrono::duration<Rep, Period> timeout) {
+    return comlynx_.WaitRx(player_, timeout);
+  }
+
+  /// See ConcurrentComLynx::WaitTxEmpty().
+  template <typename Rep, typename Period>
+  inline bool WaitTxEmpty(std::chrono::duration<Rep, Period> timeout) {
+    return comlynx_.WaitTxEmpty(player_, timeout);
+  }
+
+  /// See ComLynx::GetGeneration().
+  constexpr inline uint64_t GetGeneration() const {
+    return comlynx_.GetGeneration();
+  }
+
+  constexpr inline Player GetPlayer() const {
     return player_;
   }
 
  private:
-  ComLynx &comlynx_;
-  ComLynx::Player const player_;
+  Bus &comlynx_;
+  Player const player_;
 };
 
+/// The bus with the player count given at run time.
+using ComLynx = BasicComLynx<>;
+using ComLynxClient = BasicComLynxClient<ComLynx>;
+
+/// The bus with the player count fixed at compile time.
+template <int kPlayers>
+using FixedComLynx = BasicComLynx<kPlayers>;
+template <int kPlayers>
+using FixedComLynxClient = BasicComLynxClient<FixedComLynx<kPlayers>>;
+
 #endif  // SUPERKODER_COMLYNX_H
@@ -0,0 +1,553 @@
+// You are free to use this in any way you like, as long as you mention:
+// ------------------------------------------------------------------------------ 
+// Copyright (c) 2024 superKoder (github.com/superKoder/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The ABOVE COPYRIGHT notice and this permission notice SHALL BE INCLUDED in all
+// copies or substantial portions of the Software.
+//
+// The software is provided "as is", without warranty of any kind, express or
+// implied, including but not limited to the warranties of merchantability,
+// fitness for a particular purpose and noninfringement. In no event shall the
+// authors or copyright holders be liable for any claim, damages or other
+// liability, whether in an action of contract, tort or otherwise, arising from,
+// out of or in connection with the software or the use or other dealings in the
+// software.
+// ------------------------------------------------------------------------------ 
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <vector>
+
+#include "comlynx.h"
+#include "comlynx_checksum.h"
+#include "comlynx_session_host.h"
+#include "comlynx_test_random.h"
+#include "comlynx_trace.h"
+#include "comlynx_wide.h"
+
+namespace {
+
+constexpr ComLynx::Player kSender = 0;
+constexpr ComLynx::Player kReceiver = 1;
+
+/// Puts `depth` unread bytes from kSender on the cable.
+void Fill(ComLynx &comlynx, int depth) {
+  for (int i = 0; i < depth; ++i) {
+    comlynx.Send(kSender, UBYTE(i));
+  }
+}
+
+/// Reads everything for every player, leaving the cable empty.
+void Drain(ComLynx &comlynx, int n_players) {
+  for (ComLynx::Player p = 0; p < n_players; ++p) {
+    while (comlynx.IsRxReady(p)) {
+      comlynx.Recv(p);
+    }
+  }
+}
+
+/// Players x buffer depth, from an empty cable up to the overrun limit.
+void PlayersAndDepths(benchmark::internal::Benchmark *b, int min_depth,
+                      int max_depth) {
+  for (int players : {2, 4, 8}) {
+    for (int depth : {0, 1, 8, 16, 31, 32}) {
+      if (depth < min_depth || depth > max_depth) continue;
+      b->Args({players, depth});
+    }
+  }
+  b->ArgNames({"players", "depth"});
+}
+
+void AllDepths(benchmark::internal::Benchmark *b) {
+  PlayersAndDepths(b, 0, ComLynx::kBufferSize);
+}
+
+void BM_Send(benchmark::State &state) {
+  auto const players = int(state.range(0));
+  auto const depth = int(state.range(1));
+  ComLynx comlynx(players);
+  comlynx.Configure(ComLynx::ParityConfig::kOdd);
+
+  // Each round fills the cable from `depth` up to the overrun limit.
+  int64_t sent = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    Drain(comlynx, players);
+    Fill(comlynx, depth);
+    state.ResumeTiming();
+    for (auto i = depth; i < int(ComLynx::kBufferSize); ++i) {
+      benchmark::DoNotOptimize(comlynx.Send(kSender, UBYTE(i)));
+    }
+    sent += ComLynx::kBufferSize - depth;
+  }
+  state.SetItemsProcessed(sent);
+}
+BENCHMARK(BM_Send)->Apply([](benchmark::internal::Benchmark *b) {
+  PlayersAndDepths(b, 0, ComLynx::kBufferSize - 1);
+});
+
+void BM_Recv(benchmark::State &state) {
+  auto const players = int(state.range(0));
+  auto const depth = int(state.range(1));
+  ComLynx comlynx(players);
+  comlynx.Configure(ComLynx::ParityConfig::kOdd);
+
+  // Each round has the receiver read `depth` bytes.
+  int64_t received = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    Drain(comlynx, players);
+    Fill(comlynx, depth);
+    state.ResumeTiming();
+    for (auto i = 0; i < depth; ++i) {
+      benchmark::DoNotOptimize(comlynx.Recv(kReceiver));
+    }
+    received += depth;
+  }
+  state.SetItemsProcessed(received);
+}
+BENCHMARK(BM_Recv)->Apply([](benchmark::internal::Benchmark *b) {
+  PlayersAndDepths(b, 1, ComLynx::kBufferSize);
+});
+
+void BM_IsRxReady(benchmark::State &state) {
+  ComLynx comlynx(int(state.range(0)));
+  comlynx.Configure(ComLynx::ParityConfig::kOdd);
+  Fill(comlynx, int(state.range(1)));
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(comlynx.IsRxReady(kReceiver));
+  }
+}
+BENCHMARK(BM_IsRxReady)->Apply(AllDepths);
+
+void BM_GetSERCTL(benchmark::State &state) {
+  ComLynx comlynx(int(state.range(0)));
+  comlynx.Configure(ComLynx::ParityConfig::kOdd);
+  Fill(comlynx, int(state.range(1)));
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(comlynx.GetSERCTL(kReceiver));
+  }
+}
+BENCHMARK(BM_GetSERCTL)->Apply(AllDepths);
+
+/// GetSERCTL when every read follows a state change, so the cached register
+/// is rebuilt each time. Only an approximation of the uncached code: it also
+/// pays for ResetErrors(), so it reads high. For the real before and after,
+/// compare BM_GetSERCTL in a Release build of this tree and of the commit
+/// before the cache.
+void BM_GetSERCTL_Rebuilt(benchmark::State &state) {
+  ComLynx comlynx(int(state.range(0)));
+  comlynx.Configure(ComLynx::ParityConfig::kOdd);
+  Fill(comlynx, int(state.range(1)));
+
+  for (auto _ : state) {
+    comlynx.ResetErrors(kReceiver);
+    benchmark::DoNotOptimize(comlynx.GetSERCTL(kReceiver));
+  }
+}
+BENCHMARK(BM_GetSERCTL_Rebuilt)->Apply(AllDepths);
+
+void BM_IsIRQ(benchmark::State &state) {
+  ComLynx comlynx(int(state.range(0)));
+  comlynx.Configure(ComLynx::ParityConfig::kOdd);
+  comlynx.EnableRxIRQ(kReceiver, true);
+  Fill(comlynx, int(state.range(1)));
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(comlynx.IsIRQ(kReceiver));
+  }
+}
+BENCHMARK(BM_IsIRQ)->Apply(AllDepths);
+
+/// BM_GetSERCTL_Rebuilt at 16 bytes deep, on a bus with the player count fixed
+/// at compile time.
+template <int kPlayers>
+void BM_GetSERCTL_Rebuilt_Fixed(benchmark::State &state) {
+  FixedComLynx<kPlayers> comlynx;
+  comlynx.Configure(ComLynx::ParityConfig::kOdd);
+  for (int i = 0; i < 16; ++i) {
+    comlynx.Send(kSender, UBYTE(i));
+  }
+
+  for (auto _ : state) {
+    comlynx.ResetErrors(kReceiver);
+    benchmark::DoNotOptimize(comlynx.GetSERCTL(kReceiver));
+  }
+}
+BENCHMARK_TEMPLATE(BM_GetSERCTL_Rebuilt_Fixed, 2);
+BENCHMARK_TEMPLATE(BM_GetSERCTL_Rebuilt_Fixed, 8);
+
+/// One round of the exchange in test_handshake_slime_world.
+template <typename Client>
+void SlimeWorldRound(Client &L1, Client &L2) {
+  ComLynx::TxNotReadyReason reason = {};
+  auto const send = [&reason](auto &client, UBYTE byte) {
+    if (client.IsTxReady(reason)) {
+      client.Send(byte);
+    }
+  };
+  auto const read_all = [](auto &client) {
+    UBYTE sum = 0;
+    while (client.IsRxReady()) {
+      sum += client.Recv();
+    }
+    return sum;
+  };
+
+  send(L1, 0x05);
+  send(L1, 0x00);
+  send(L2, 0x05);
+  send(L1, 0x00);
+  send(L1, 0x01);
+  send(L2, 0x00);
+  send(L1, 0x05);
+  send(L1, 0x00);
+  send(L1, 0xF4);
+  benchmark::DoNotOptimize(read_all(L2));
+
+  send(L2, 0x01);
+  send(L2, 0x03);
+  send(L2, 0x05);
+  send(L2, 0x00);
+  send(L2, 0xF1);
+  benchmark::DoNotOptimize(read_all(L1));
+}
+
+/// The same exchange as test_handshake_slime_world, over and over.
+template <typename Bus>
+void BM_SlimeWorldHandshake(benchmark::State &state) {
+  Bus comlynx(2);
+  comlynx.Configure(ComLynx::ParityConfig::kOdd);
+  BasicComLynxClient<Bus> L1(comlynx, 0);
+  BasicComLynxClient<Bus> L2(comlynx, 1);
+
+  for (auto _ : state) {
+    SlimeWorldRound(L1, L2);
+  }
+  state.SetItemsProcessed(state.iterations() * 14);
+}
+BENCHMARK_TEMPLATE(BM_SlimeWorldHandshake, ComLynx);
+BENCHMARK_TEMPLATE(BM_SlimeWorldHandshake, FixedComLynx<2>);
+
+/// BM_SlimeWorldHandshake with every event going into a trace.
+void BM_SlimeWorldHandshake_Recorded(benchmark::State &state) {
+  constexpr int kRoundsPerTrace = 1024;
+  ComLynx comlynx(2);
+  auto trace = std::make_unique<ComLynxTraceWriter>();
+  ComLynxRecorder recorder(comlynx, *trace);
+  recorder.Configure(ComLynx::ParityConfig::kOdd);
+  ComLynxRecorderClient L1(recorder, 0);
+  ComLynxRecorderClient L2(recorder, 1);
+
+  int rounds = 0;
+  for (auto _ : state) {
+    SlimeWorldRound(L1, L2);
+    if (++rounds == kRoundsPerTrace) {
+      // Keep the trace from growing for the whole run.
+      state.PauseTiming();
+      benchmark::DoNotOptimize(trace->size());
+      *trace = ComLynxTraceWriter();
+      rounds = 0;
+      state.ResumeTiming();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * 14);
+}
+BENCHMARK(BM_SlimeWorldHandshake_Recorded);
+
+/// Replays a recorded session of many handshakes; items are trace events.
+void BM_ReplayTrace(benchmark::State &state) {
+  ComLynx original(2);
+  ComLynxTraceWriter trace;
+  {
+    ComLynxRecorder recorder(original, trace);
+    recorder.Configure(ComLynx::ParityConfig::kOdd);
+    ComLynxRecorderClient L1(recorder, 0);
+    ComLynxRecorderClient L2(recorder, 1);
+    for (int i = 0; i < 1000; ++i) {
+      SlimeWorldRound(L1, L2);
+    }
+  }
+
+  ComLynx comlynx(2);
+  size_t events = 0;
+  for (auto _ : state) {
+    ComLynxTraceReader reader(trace.data(), trace.size());
+    if (!ReplayComLynxTrace(reader, comlynx, events)) {
+      state.SkipWithError("replay diverged");
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * int64_t(events));
+  state.counters["trace_bytes"] = double(trace.size());
+}
+BENCHMARK(BM_ReplayTrace);
+
+/// BM_Send's work as one SendBurst and one RecvAvailable per round.
+void BM_SendBurst(benchmark::State &state) {
+  auto const players = int(state.range(0));
+  auto const depth = int(state.range(1));
+  ComLynx comlynx(players);
+  comlynx.Configure(ComLynx::ParityConfig::kOdd);
+  std::array<UBYTE, ComLynx::kBufferSize> bytes = {};
+
+  int64_t sent = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    Drain(comlynx, players);
+    Fill(comlynx, depth);
+    state.ResumeTiming();
+    sent += comlynx.SendBurst(kSender, bytes.data(),
+                              ComLynx::kBufferSize - depth);
+  }
+  state.SetItemsProcessed(sent);
+}
+BENCHMARK(BM_SendBurst)->Apply([](benchmark::internal::Benchmark *b) {
+  PlayersAndDepths(b, 0, ComLynx::kBufferSize - 1);
+});
+
+void BM_RecvAvailable(benchmark::State &state) {
+  auto const players = int(state.range(0));
+  auto const depth = int(state.range(1));
+  ComLynx comlynx(players);
+  comlynx.Configure(ComLynx::ParityConfig::kOdd);
+  std::array<UBYTE, ComLynx::kBufferSize> bytes = {};
+
+  int64_t read = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    Drain(comlynx, players);
+    Fill(comlynx, depth);
+    state.ResumeTiming();
+    read += comlynx.RecvAvailable(kReceiver, bytes.data(), bytes.size());
+  }
+  state.SetItemsProcessed(read);
+}
+BENCHMARK(BM_RecvAvailable)->Apply([](benchmark::internal::Benchmark *b) {
+  PlayersAndDepths(b, 1, ComLynx::kBufferSize);
+});
+
+/// A host polling every player's UART once per scanline on a quiet cable.
+void BM_IdlePoll(benchmark::State &state) {
+  auto const players = int(state.range(0));
+  ComLynx comlynx(players);
+  comlynx.Configure(ComLynx::ParityConfig::kOdd);
+
+  for (auto _ : state) {
+    for (ComLynx::Player p = 0; p < players; ++p) {
+      benchmark::DoNotOptimize(comlynx.IsRxReady(p));
+      benchmark::DoNotOptimize(comlynx.IsIRQ(p));
+      benchmark::DoNotOptimize(comlynx.GetSERCTL(p));
+    }
+  }
+}
+BENCHMARK(BM_IdlePoll)->Arg(2)->Arg(8)->ArgName("players");
+
+/// The same host, skipping the polls while the generation stands still.
+void BM_IdlePoll_Generation(benchmark::State &state) {
+  auto const players = int(state.range(0));
+  ComLynx comlynx(players);
+  comlynx.Configure(ComLynx::ParityConfig::kOdd);
+
+  uint64_t seen = ~uint64_t{0};
+  for (auto _ : state) {
+    auto const generation = comlynx.GetGeneration();
+    if (generation == seen) continue;
+    seen = generation;
+    for (ComLynx::Player p = 0; p < players; ++p) {
+      benchmark::DoNotOptimize(comlynx.IsRxReady(p));
+      benchmark::DoNotOptimize(comlynx.IsIRQ(p));
+      benchmark::DoNotOptimize(comlynx.GetSERCTL(p));
+    }
+  }
+}
+BENCHMARK(BM_IdlePoll_Generation)->Arg(2)->Arg(8)->ArgName("players");
+
+/// Rollback netplay: save the bus into a ring every frame, and now and then
+/// roll back a few frames.
+template <typename Bus>
+void BM_SnapshotRing(benchmark::State &state) {
+  constexpr size_t kRing = 8;
+  Bus comlynx(8);
+  comlynx.Configure(ComLynx::ParityConfig::kOdd);
+  for (int i = 0; i < 16; ++i) {
+    comlynx.Send(kSender, UBYTE(i));
+  }
+  std::array<ComLynx::SavedState, kRing> ring;
+
+  size_t frame = 0;
+  for (auto _ : state) {
+    comlynx.Snapshot(ring[frame % kRing]);
+    if (frame % kRing == kRing - 1) {
+      comlynx.Restore(ring[(frame - 4) % kRing]);
+    }
+    ++frame;
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(state.iterations() * sizeof(ComLynx::SavedState));
+}
+BENCHMARK_TEMPLATE(BM_SnapshotRing, ComLynx);
+BENCHMARK_TEMPLATE(BM_SnapshotRing, FixedComLynx<8>);
+
+/// Save-state round trip through the binary format, at various depths.
+void BM_SerializeDeserialize(benchmark::State &state) {
+  auto const players = int(state.range(0));
+  auto const depth = int(state.range(1));
+  ComLynx comlynx(players);
+  comlynx.Configure(ComLynx::ParityConfig::kOdd);
+  Fill(comlynx, depth);
+  std::array<UBYTE, ComLynx::kMaxSerializedSize> blob;
+
+  size_t size = 0;
+  for (auto _ : state) {
+    size = comlynx.Serialize(blob.data(), blob.size());
+    benchmark::DoNotOptimize(comlynx.Deserialize(blob.data(), size));
+  }
+  state.counters["blob_bytes"] = double(size);
+}
+BENCHMARK(BM_SerializeDeserialize)->Apply(AllDepths);
+
+std::vector<UBYTE> CapturedBytes(size_t size) {
+  std::vector<UBYTE> bytes(size);
+  ComLynxTestRandom random(1);
+  for (auto &byte : bytes) {
+    byte = UBYTE(random(256));
+  }
+  return bytes;
+}
+
+/// The byte-at-a-time loop ComLynxCommonChecksum(data, size) replaces.
+void BM_ChecksumScalar(benchmark::State &state) {
+  auto const bytes = CapturedBytes(size_t(state.range(0)));
+  for (auto _ : state) {
+    UBYTE sum = 0;
+    for (auto byte : bytes) {
+      sum += byte;
+      benchmark::DoNotOptimize(sum);
+    }
+    benchmark::DoNotOptimize(UBYTE(255 - sum));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ChecksumScalar)->Arg(64)->Arg(4096)->Arg(1 << 20);
+
+void BM_Checksum(benchmark::State &state) {
+  auto const bytes = CapturedBytes(size_t(state.range(0)));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ComLynxCommonChecksum(bytes.data(), bytes.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Checksum)->Arg(64)->Arg(4096)->Arg(1 << 20);
+
+void BM_ParityBits(benchmark::State &state) {
+  auto const bytes = CapturedBytes(size_t(state.range(0)));
+  std::vector<UBYTE> bits((bytes.size() + 7) / 8);
+  for (auto _ : state) {
+    ComLynxParityBits(false, bytes.data(), bytes.size(), bits.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ParityBits)->Arg(64)->Arg(4096)->Arg(1 << 20);
+
+/// The cost of putting one byte on a cable with this many listeners.
+template <typename Bus>
+void BM_BroadcastSend(benchmark::State &state) {
+  auto const players = int(state.range(0));
+  Bus comlynx(players);
+  comlynx.Configure(ComLynx::ParityConfig::kOdd);
+
+  int64_t sent = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    for (ComLynx::Player p = 0; p < players; ++p) {
+      while (comlynx.IsRxReady(p)) {
+        comlynx.Recv(p);
+      }
+    }
+    state.ResumeTiming();
+    for (size_t i = 0; i < ComLynx::kBufferSize; ++i) {
+      benchmark::DoNotOptimize(comlynx.Send(kSender, UBYTE(i)));
+    }
+    sent += ComLynx::kBufferSize;
+  }
+  state.SetItemsProcessed(sent);
+}
+BENCHMARK_TEMPLATE(BM_BroadcastSend, ComLynx)->Arg(8)->ArgName("players");
+BENCHMARK_TEMPLATE(BM_BroadcastSend, WideComLynx)
+    ->Arg(8)
+    ->Arg(64)
+    ->Arg(256)
+    ->ArgName("players");
+
+/// One byte sent and read by every listener; items are deliveries.
+template <typename Bus>
+void BM_BroadcastDeliver(benchmark::State &state) {
+  auto const players = int(state.range(0));
+  Bus comlynx(players);
+  comlynx.Configure(ComLynx::ParityConfig::kOdd);
+
+  for (auto _ : state) {
+    comlynx.Send(kSender, 'A');
+    for (ComLynx::Player p = 1; p < players; ++p) {
+      benchmark::DoNotOptimize(comlynx.Recv(p));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * (players - 1));
+}
+BENCHMARK_TEMPLATE(BM_BroadcastDeliver, ComLynx)->Arg(8)->ArgName("players");
+BENCHMARK_TEMPLATE(BM_BroadcastDeliver, WideComLynx)
+    ->Arg(8)
+    ->Arg(64)
+    ->Arg(256)
+    ->ArgName("players");
+
+/// 1000 lobbies, one in 64 busy, serviced a round at a time. Compare the
+/// items/s across thread counts to see how the host scales on this machine.
+void LobbyRound(void *context, ComLynx &bus) {
+  auto const load = *static_cast<int const *>(context);
+  UBYTE bytes[ComLynx::kBufferSize];
+  for (int sent = 0; sent < load; sent += int(ComLynx::kBufferSize)) {
+    for (size_t i = 0; i < ComLynx::kBufferSize; ++i) {
+      bus.Send(0, UBYTE(i));
+    }
+    benchmark::DoNotOptimize(bus.RecvAvailable(1, bytes, sizeof(bytes)));
+  }
+}
+
+void BM_SessionHost(benchmark::State &state) {
+  auto const n_lobbies = 1000;
+  ComLynxSessionHost host(size_t(state.range(0)));
+  std::vector<int> loads(n_lobbies);
+  for (int i = 0; i < n_lobbies; ++i) {
+    loads[i] = (i % 64 == 0) ? 4096 : 32;
+    auto const handle = host.Open(2, LobbyRound, &loads[i]);
+    host.Get(handle)->Configure(ComLynx::ParityConfig::kOdd);
+  }
+
+  for (auto _ : state) {
+    host.RunRound();
+  }
+  state.SetItemsProcessed(state.iterations() * n_lobbies);
+  state.counters["steals"] = double(host.GetStealCount());
+}
+BENCHMARK(BM_SessionHost)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8)
+    ->ArgName("threads")
+    ->UseRealTime();
+
+}  // namespace
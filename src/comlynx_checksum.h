@@ -0,0 +1,173 @@
+// You are free to use this in any way you like, as long as you mention:
+// ------------------------------------------------------------------------------
+// Copyright (c) 2024 superKoder (github.com/superKoder/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The ABOVE COPYRIGHT notice and this permission notice SHALL BE INCLUDED in
+// all copies or substantial portions of the Software.
+//
+// The software is provided "as is", without warranty of any kind, express or
+// implied, including but not limited to the warranties of merchantability,
+// fitness for a particular purpose and noninfringement. In no event shall the
+// authors or copyright holders be liable for any claim, damages or other
+// liability, whether in an action of contract, tort or otherwise, arising from,
+// out of or in connection with the software or the use or other dealings in the
+// software.
+// ------------------------------------------------------------------------------
+
+#ifndef SUPERKODER_COMLYNX_CHECKSUM_H
+#define SUPERKODER_COMLYNX_CHECKSUM_H
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#include "comlynx.h"
+
+/**
+ * ComLynxCommonChecksum() and parity for whole buffers, for checking captured
+ * packets and traces in bulk. Uses AVX2 or SSE2 when the compiler targets
+ * them (e.g. -mavx2) and plain C++ otherwise; the results are the same.
+ */
+
+namespace comlynx_detail {
+
+/// Sum of all bytes, modulo 256.
+inline UBYTE SumBytes(UBYTE const *data, size_t size) {
+  uint64_t sum = 0;
+  size_t i = 0;
+#if defined(__AVX2__)
+  // SAD against zero adds up each group of 8 bytes into a 64-bit lane.
+  auto const zero256 = _mm256_setzero_si256();
+  auto acc256 = _mm256_setzero_si256();
+  for (; i + 32 <= size; i += 32) {
+    auto const bytes =
+        _mm256_loadu_si256(reinterpret_cast<__m256i const *>(data + i));
+    acc256 = _mm256_add_epi64(acc256, _mm256_sad_epu8(bytes, zero256));
+  }
+  alignas(32) uint64_t lanes256[4];
+  _mm256_store_si256(reinterpret_cast<__m256i *>(lanes256), acc256);
+  sum += lanes256[0] + lanes256[1] + lanes256[2] + lanes256[3];
+#endif
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+  auto const zero = _mm_setzero_si128();
+  auto acc = _mm_setzero_si128();
+  for (; i + 16 <= size; i += 16) {
+    auto const bytes =
+        _mm_loadu_si128(reinterpret_cast<__m128i const *>(data + i));
+    acc = _mm_add_epi64(acc, _mm_sad_epu8(bytes, zero));
+  }
+  alignas(16) uint64_t lanes[2];
+  _mm_store_si128(reinterpret_cast<__m128i *>(lanes), acc);
+  sum += lanes[0] + lanes[1];
+#endif
+  for (; i < size; ++i) {
+    sum += data[i];
+  }
+  return static_cast<UBYTE>(sum);
+}
+
+}  // namespace comlynx_detail
+
+/// The checksum used by most ComLynx games, over a whole buffer.
+inline UBYTE ComLynxCommonChecksum(UBYTE const *data, size_t size) {
+  return 255 - comlynx_detail::SumBytes(data, size);
+}
+
+/**
+ * The parity bit of every byte in `data` (see CalculateParity()), packed LSB
+ * first: the bit for `data[k]` is bit `k % 8` of `bits[k / 8]`. `bits` needs
+ * room for (size + 7) / 8 bytes; unused bits of the last one are cleared.
+ */
+inline void ComLynxParityBits(bool even_parity, UBYTE const *data,
+                              size_t size, UBYTE *bits) {
+  size_t i = 0;
+  // The vector loops fold each byte onto its lowest bit in place. Shifts go
+  // across 16-bit lanes, but only ever move a byte's own bits into bit 0.
+#if defined(__AVX2__)
+  auto const invert256 = _mm256_set1_epi8(even_parity ? 0 : 1);
+  for (; i + 32 <= size; i += 32) {
+    auto x = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(data + i));
+    x = _mm256_xor_si256(x, _mm256_srli_epi16(x, 4));
+    x = _mm256_xor_si256(x, _mm256_srli_epi16(x, 2));
+    x = _mm256_xor_si256(x, _mm256_srli_epi16(x, 1));
+    x = _mm256_xor_si256(x, invert256);
+    auto const mask =
+        static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_slli_epi16(x, 7)));
+    for (int k = 0; k < 4; ++k) {
+      bits[i / 8 + k] = static_cast<UBYTE>(mask >> (8 * k));
+    }
+  }
+#endif
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+  auto const invert = _mm_set1_epi8(even_parity ? 0 : 1);
+  for (; i + 16 <= size; i += 16) {
+    auto x = _mm_loadu_si128(reinterpret_cast<__m128i const *>(data + i));
+    x = _mm_xor_si128(x, _mm_srli_epi16(x, 4));
+    x = _mm_xor_si128(x, _mm_srli_epi16(x, 2));
+    x = _mm_xor_si128(x, _mm_srli_epi16(x, 1));
+    x = _mm_xor_si128(x, invert);
+    auto const mask =
+        static_cast<uint32_t>(_mm_movemask_epi8(_mm_slli_epi16(x, 7)));
+    bits[i / 8] = static_cast<UBYTE>(mask);
+    bits[i / 8 + 1] = static_cast<UBYTE>(mask >> 8);
+  }
+#endif
+  for (; i < size; i += 8) {
+    UBYTE byte = {};
+    for (size_t k = 0; k < 8 && i + k < size; ++k) {
+      byte |= UBYTE(CalculateParity(even_parity, data[i + k]) << k);
+    }
+    bits[i / 8] = byte;
+  }
+}
+
+/**
+ * ComLynxCommonChecksum() for a packet that arrives in pieces: feed it every
+ * piece, in order, and read Checksum() at the end.
+ */
+class ComLynxChecksumAccumulator {
+ public:
+  constexpr inline void Reset() {
+    sum_ = {};
+    size_ = {};
+  }
+
+  constexpr inline void Update(UBYTE byte) {
+    sum_ += byte;
+    ++size_;
+  }
+
+  inline void Update(UBYTE const *data, size_t size) {
+    sum_ += comlynx_detail::SumBytes(data, size);
+    size_ += size;
+  }
+
+  /// The checksum of everything so far.
+  constexpr inline UBYTE Checksum() const {
+    return 255 - sum_;
+  }
+
+  /// Bytes fed in so far.
+  constexpr inline size_t size() const {
+    return size_;
+  }
+
+ private:
+  UBYTE sum_ = {};
+  size_t size_ = {};
+};
+
+#endif  // SUPERKODER_COMLYNX_CHECKSUM_H
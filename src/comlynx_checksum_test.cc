@@ -0,0 +1,107 @@
+// You are free to use this in any way you like, as long as you mention:
+// ------------------------------------------------------------------------------ 
+// Copyright (c) 2024 superKoder (github.com/superKoder/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The ABOVE COPYRIGHT notice and this permission notice SHALL BE INCLUDED in all
+// copies or substantial portions of the Software.
+//
+// The software is provided "as is", without warranty of any kind, express or
+// implied, including but not limited to the warranties of merchantability,
+// fitness for a particular purpose and noninfringement. In no event shall the
+// authors or copyright holders be liable for any claim, damages or other
+// liability, whether in an action of contract, tort or otherwise, arising from,
+// out of or in connection with the software or the use or other dealings in the
+// software.
+// ------------------------------------------------------------------------------ 
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "comlynx_checksum.h"
+#include "comlynx_test_random.h"
+
+namespace {
+
+std::vector<UBYTE> RandomBytes(size_t size, uint32_t seed) {
+    ComLynxTestRandom random(seed);
+    std::vector<UBYTE> bytes(size);
+    for (auto &byte : bytes) {
+        byte = UBYTE(random(256));
+    }
+    return bytes;
+}
+
+}  // namespace
+
+TEST(ComLynxChecksumTest, test_slime_world_packet) {
+    UBYTE const packet[] = {0x05, 0x00, 0x00, 0x01, 0x05, 0x00};
+    EXPECT_EQ(ComLynxCommonChecksum(packet, sizeof(packet)), 0xF4);
+    EXPECT_EQ(ComLynxCommonChecksum(packet, 0), 0xFF);
+}
+
+TEST(ComLynxChecksumTest, test_matches_scalar_at_every_size_and_offset) {
+    auto const bytes = RandomBytes(300, 1);
+    for (size_t offset = 0; offset < 3; ++offset) {
+        for (size_t size = 0; size + offset <= bytes.size(); ++size) {
+            UBYTE sum = 0;
+            for (size_t i = 0; i < size; ++i) sum += bytes[offset + i];
+            ASSERT_EQ(ComLynxCommonChecksum(bytes.data() + offset, size),
+                      UBYTE(255 - sum))
+                << "offset " << offset << " size " << size;
+        }
+    }
+}
+
+TEST(ComLynxChecksumTest, test_parity_bits) {
+    auto const bytes = RandomBytes(300, 2);
+    std::vector<UBYTE> bits((bytes.size() + 7) / 8 + 1);
+    for (bool even : {false, true}) {
+        for (size_t offset = 0; offset < 3; ++offset) {
+            for (size_t size = 0; size + offset <= bytes.size(); ++size) {
+                std::fill(bits.begin(), bits.end(), 0xAA);
+                ComLynxParityBits(even, bytes.data() + offset, size,
+                                  bits.data());
+                for (size_t k = 0; k < (size + 7) / 8 * 8; ++k) {
+                    auto const expected =
+                        k < size && CalculateParity(even, bytes[offset + k]);
+                    ASSERT_EQ(bool(bits[k / 8] & (1 << (k % 8))), expected)
+                        << "even " << even << " size " << size << " bit " << k;
+                }
+                // Nothing written past the last byte it needs.
+                EXPECT_EQ(bits[(size + 7) / 8], 0xAA);
+            }
+        }
+    }
+}
+
+TEST(ComLynxChecksumTest, test_accumulator_in_pieces) {
+    auto const bytes = RandomBytes(1000, 3);
+    ComLynxChecksumAccumulator accumulator;
+    EXPECT_EQ(accumulator.Checksum(), 0xFF);
+
+    size_t pos = 0;
+    for (size_t piece = 1; pos < bytes.size(); piece = piece * 3 % 97 + 1) {
+        auto const size = std::min(piece, bytes.size() - pos);
+        if (size == 1) {
+            accumulator.Update(bytes[pos]);
+        } else {
+            accumulator.Update(bytes.data() + pos, size);
+        }
+        pos += size;
+    }
+    EXPECT_EQ(accumulator.size(), bytes.size());
+    EXPECT_EQ(accumulator.Checksum(),
+              ComLynxCommonChecksum(bytes.data(), bytes.size()));
+
+    accumulator.Reset();
+    EXPECT_EQ(accumulator.size(), 0u);
+    EXPECT_EQ(accumulator.Checksum(), 0xFF);
+}
@@ -0,0 +1,467 @@
+// You are free to use this in any way you like, as long as you mention:
+// ------------------------------------------------------------------------------
+// Copyright (c) 2024 superKoder (github.com/superKoder/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The ABOVE COPYRIGHT notice and this permission notice SHALL BE INCLUDED in
+// all copies or substantial portions of the Software.
+//
+// The software is provided "as is", without warranty of any kind, express or
+// implied, including but not limited to the warranties of merchantability,
+// fitness for a particular purpose and noninfringement. In no event shall the
+// authors or copyright holders be liable for any claim, damages or other
+// liability, whether in an action of contract, tort or otherwise, arising from,
+// out of or in connection with the software or the use or other dealings in the
+// software.
+// ------------------------------------------------------------------------------
+
+#ifndef SUPERKODER_COMLYNX_CONCURRENT_H
+#define SUPERKODER_COMLYNX_CONCURRENT_H
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <climits>
+#include <ctime>
+#endif
+
+#include "comlynx.h"
+
+/**
+ * Lock-free ComLynx for buses where every Lynx runs on its own thread.
+ *
+ * The rule is one thread per player: all calls for a given player must come
+ * from the same thread, but different players may call in at the same time.
+ * Configure() and SendBreak() may be called from any thread.
+ *
+ * Bytes go into one 32-slot broadcast ring. A sender claims the next slot
+ * with a CAS on the tail, fills it in and publishes it by storing its sequence
+ * number. Each player owns its read cursor, and a slot is free again once
+ * every cursor has moved past it, so the status calls only ever load shared
+ * state and never take a lock.
+ *
+ * Threads that have nothing to do until a byte arrives can block in WaitRx()
+ * or WaitTxEmpty() instead of spinning. They sleep on a futex (Linux; other
+ * systems poll with short sleeps), which works across processes too, and
+ * Send/Recv only pay for a load of a shared counter unless someone is
+ * waiting. Everything a waiter waits for is published with seq_cst stores for
+ * that, which on x86 cost an exchange on a line the caller already owns.
+ *
+ * Frame timing (ComLynx::ConfigureFrameTime) is not supported here; bytes are
+ * delivered as soon as they are published.
+ */
+class ConcurrentComLynx {
+ public:
+  using Player = ComLynx::Player;
+  using ParityConfig = ComLynx::ParityConfig;
+  using TxNotReadyReason = ComLynx::TxNotReadyReason;
+  using Index = uint32_t;
+
+  static constexpr size_t kBufferSize = ComLynx::kBufferSize;
+  static constexpr Player kMaxPlayers = 8;
+
+  inline explicit ConcurrentComLynx(Player n_players)
+      : n_players_{n_players} {
+    COMLYNX_ASSERT(n_players > 0 && n_players <= kMaxPlayers);
+  }
+
+  ConcurrentComLynx(ConcurrentComLynx const &) = delete;
+  ConcurrentComLynx &operator=(ConcurrentComLynx const &) = delete;
+
+  constexpr inline Player GetPlayerCount() const {
+    return n_players_;
+  }
+
+  inline void Configure(bool enable_parity, bool even_parity) {
+    UBYTE config = kConfigured;
+    config |= enable_parity ? kEnableParity : 0;
+    config |= even_parity ? kEvenParity : 0;
+    config_.store(config, std::memory_order_release);
+  }
+
+  inline void Configure(ParityConfig config) {
+    switch (config) {
+      case ParityConfig::kOdd:
+        Configure(true, false);
+        return;
+      case ParityConfig::kEven:
+        Configure(true, true);
+        return;
+      case ParityConfig::kSpace:
+        Configure(false, false);
+        return;
+      case ParityConfig::kMark:
+        Configure(false, true);
+        return;
+    }
+  }
+
+  inline void EnableRxIRQ(Player player, bool value) {
+    COMLYNX_ASSERT(IsConfigured());
+    players_[player].rx_int_en.store(value, std::memory_order_relaxed);
+  }
+
+  inline void EnableTxIRQ(Player player, bool value) {
+    COMLYNX_ASSERT(IsConfigured());
+    players_[player].tx_int_en.store(value, std::memory_order_relaxed);
+  }
+
+  inline bool Send(Player player, UBYTE data) {
+    COMLYNX_ASSERT(IsConfigured());
+    auto &state = players_[player];
+
+    // Claim the next slot, as long as every reader is far enough along.
+    auto tail = tail_.load(std::memory_order_acquire);
+    do {
+      if (IsFull(tail)) {
+        state.errors.fetch_or(kOverrunError, std::memory_order_relaxed);
+        return false;
+      }
+    } while (!tail_.compare_exchange_weak(tail, tail + 1,
+                                          std::memory_order_acq_rel,
+                                          std::memory_order_acquire));
+
+    auto &slot = slots_[tail & kMask];
+    slot.data = data;
+    slot.sender = static_cast<UBYTE>(player);
+    slot.parity = ParityFor(data);
+    slot.sequence.store(tail + 1, std::memory_order_seq_cst);
+
+    state.sent_end.store(tail + 1, std::memory_order_relaxed);
+    SkipOwnMessages(player);
+    WakeWaiters();
+    return true;
+  }
+
+  inline UBYTE Recv(Player player) {
+    COMLYNX_ASSERT(IsConfigured());
+
+    auto const slot = FirstUnreadSlot(player);
+    COMLYNX_ASSERT(slot);
+
+    auto const data = slot->data;
+    auto &cursor = players_[player].cursor;
+    cursor.store(cursor.load(std::memory_order_relaxed) + 1,
+                 std::memory_order_seq_cst);
+    SkipOwnMessages(player);
+    WakeWaiters();
+    return data;
+  }
+
+  inline void SendBreak() {
+    COMLYNX_ASSERT(IsConfigured());
+    for (Player i = 0; i < n_players_; ++i) {
+      players_[i].rx_break.store(true, std::memory_order_relaxed);
+    }
+  }
+
+  /// Player can only read when something new is available.
+  inline bool IsRxReady(Player player) {
+    COMLYNX_ASSERT(IsConfigured());
+
+    auto const slot = FirstUnreadSlot(player);
+    if (nullptr == slot) {
+      return false;
+    }
+    if (slot->parity != CalculateParity(IsEvenParity(), slot->data)) {
+      players_[player].errors.fetch_or(kParityError,
+                                       std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  /// Blocks until IsRxReady(player) or until `timeout` has passed. Returns
+  /// whether there is something to read.
+  template <typename Rep, typename Period>
+  inline bool WaitRx(Player player,
+                     std::chrono::duration<Rep, Period> timeout) {
+    return WaitFor(timeout, [this, player] { return IsRxReady(player); });
+  }
+
+  /// Blocks until IsTxEmpty(player) or until `timeout` has passed. Returns
+  /// whether everything the player sent has been read.
+  template <typename Rep, typename Period>
+  inline bool WaitTxEmpty(Player player,
+                          std::chrono::duration<Rep, Period> timeout) {
+    return WaitFor(timeout, [this, player] { return IsTxEmpty(player); });
+  }
+
+  /// Player can only write after everything has been read.
+  inline bool IsTxReady(Player player, TxNotReadyReason &reason) const {
+    COMLYNX_ASSERT(IsConfigured());
+
+    if (IsFull(tail_.load(std::memory_order_acquire))) {
+      reason = TxNotReadyReason::kOverrun;
+      return false;
+    }
+    return true;
+  }
+
+  inline bool IsTxEmpty(Player player) const {
+    COMLYNX_ASSERT(IsConfigured());
+
+    // Empty once every other player has read past our last byte.
+    auto const sent_end =
+        players_[player].sent_end.load(std::memory_order_relaxed);
+    for (Player i = 0; i < n_players_; ++i) {
+      if (i == player) continue;
+      auto const cursor = players_[i].cursor.load(std::memory_order_seq_cst);
+      if (static_cast<int32_t>(sent_end - cursor) > 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  inline bool IsRxBrk(Player player) {
+    COMLYNX_ASSERT(IsConfigured());
+    return players_[player].rx_break.exchange(false,
+                                              std::memory_order_relaxed);
+  }
+
+  inline bool IsIRQ(Player player) {
+    auto const &state = players_[player];
+    if (state.rx_int_en.load(std::memory_order_relaxed) && IsRxReady(player)) {
+      return true;
+    }
+    TxNotReadyReason reason = {};
+    if (state.tx_int_en.load(std::memory_order_relaxed) &&
+        IsTxReady(player, reason)) {
+      return true;
+    }
+    return false;
+  }
+
+  inline bool HasFrameError(Player player) const {
+    COMLYNX_ASSERT(IsConfigured());
+    return LoadErrors(player) & kFrameError;
+  }
+
+  inline bool HasOverrunError(Player player) const {
+    COMLYNX_ASSERT(IsConfigured());
+    return LoadErrors(player) & kOverrunError;
+  }
+
+  inline bool HasParityError(Player player) const {
+    COMLYNX_ASSERT(IsConfigured());
+    return LoadErrors(player) & kParityError;
+  }
+
+  inline bool HasAnyError(Player player) const {
+    COMLYNX_ASSERT(IsConfigured());
+    return LoadErrors(player) != 0;
+  }
+
+  inline void ResetErrors(Player player) {
+    COMLYNX_ASSERT(IsConfigured());
+    players_[player].errors.store(0, std::memory_order_relaxed);
+  }
+
+  inline UBYTE GetSERCTL(Player player) {
+    COMLYNX_ASSERT(IsConfigured());
+
+    TxNotReadyReason reason = {};
+    auto const tx_ready = IsTxReady(player, reason);
+    auto const rx_ready = IsRxReady(player);
+    auto const tx_empty = IsTxEmpty(player);
+    auto const errors = LoadErrors(player);
+    auto const rx_break =
+        players_[player].rx_break.load(std::memory_order_relaxed);
+    auto const slot = FirstUnreadSlot(player);
+    auto const parity_bit = slot && ParityFor(slot->data);
+
+    UBYTE byte = {};
+    byte |= tx_ready ? 0x80 : 0x00;
+    byte |= rx_ready ? 0x40 : 0x00;
+    byte |= tx_empty ? 0x20 : 0x00;
+    byte |= (errors & kParityError) ? 0x10 : 0x00;
+    byte |= (errors & kOverrunError) ? 0x08 : 0x00;
+    byte |= (errors & kFrameError) ? 0x04 : 0x00;
+    byte |= rx_break ? 0x02 : 0x00;
+    byte |= parity_bit ? 0x01 : 0x00;
+    return byte;
+  }
+
+ private:
+  static constexpr Index kMask = kBufferSize - 1;
+
+  static constexpr UBYTE kConfigured = 0x01;
+  static constexpr UBYTE kEnableParity = 0x02;
+  static constexpr UBYTE kEvenParity = 0x04;
+
+  static constexpr UBYTE kOverrunError = 0x01;
+  static constexpr UBYTE kParityError = 0x02;
+  static constexpr UBYTE kFrameError = 0x04;
+
+  struct Slot {
+    /// Index + 1 of the byte in this slot, stored last by the sender.
+    std::atomic<Index> sequence{0};
+    UBYTE data = {};
+    UBYTE sender = {};
+    bool parity = {};
+  };
+
+  /// Written by its own player only, so each gets its own cache line.
+  struct alignas(64) PlayerState {
+    std::atomic<Index> cursor{0};
+    std::atomic<Index> sent_end{0};
+    std::atomic<UBYTE> errors{0};
+    std::atomic<bool> rx_break{false};
+    std::atomic<bool> rx_int_en{false};
+    std::atomic<bool> tx_int_en{false};
+  };
+
+  Player const n_players_;
+  std::atomic<UBYTE> config_{0};
+  /// Threads blocked in WaitFor(), and the futex word they sleep on.
+  alignas(64) std::atomic<uint32_t> waiters_{0};
+  std::atomic<uint32_t> wake_sequence_{0};
+  alignas(64) std::atomic<Index> tail_{0};
+  alignas(64) std::array<Slot, kBufferSize> slots_ = {};
+  std::array<PlayerState, kMaxPlayers> players_ = {};
+
+  /// Called after every change a waiter could be waiting for. The change
+  /// and this load are seq_cst, and so are the waiter's increment and its
+  /// checks, so one side comes first in the single total order: either we see
+  /// the waiter, or it sees our change. Nobody writes `waiters_` until someone
+  /// waits, so the line stays shared and the load stays cheap.
+  inline void WakeWaiters() {
+    if (waiters_.load(std::memory_order_seq_cst) == 0) return;
+
+    wake_sequence_.fetch_add(1, std::memory_order_release);
+#ifdef __linux__
+    ::syscall(SYS_futex, &wake_sequence_, FUTEX_WAKE, INT_MAX, nullptr,
+              nullptr, 0);
+#endif
+  }
+
+  template <typename Rep, typename Period, typename Ready>
+  inline bool WaitFor(std::chrono::duration<Rep, Period> timeout,
+                      Ready const &ready) {
+    using Clock = std::chrono::steady_clock;
+    if (ready()) return true;
+
+    auto const deadline =
+        Clock::now() + std::chrono::duration_cast<Clock::duration>(timeout);
+    waiters_.fetch_add(1, std::memory_order_seq_cst);
+    auto result = false;
+    for (;;) {
+      // Reading a newer sequence also means seeing the change behind it.
+      auto const sequence = wake_sequence_.load(std::memory_order_acquire);
+      if (ready()) {
+        result = true;
+        break;
+      }
+      auto const now = Clock::now();
+      if (now >= deadline) break;
+      Sleep(sequence, deadline - now);
+    }
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+    return result;
+  }
+
+  /// Sleeps until WakeWaiters() moves on from `sequence`, or for `duration`.
+  inline void Sleep(uint32_t sequence,
+                    std::chrono::steady_clock::duration duration) {
+#ifdef __linux__
+    auto const ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    timespec relative = {};
+    relative.tv_sec = static_cast<time_t>(ns / 1000000000);
+    relative.tv_nsec = static_cast<long>(ns % 1000000000);
+    ::syscall(SYS_futex, &wake_sequence_, FUTEX_WAIT, sequence, &relative,
+              nullptr, 0);
+#else
+    (void)sequence;
+    std::this_thread::sleep_for(
+        std::min<std::chrono::steady_clock::duration>(
+            duration, std::chrono::microseconds(50)));
+#endif
+  }
+
+  inline bool IsConfigured() const {
+    return config_.load(std::memory_order_relaxed) & kConfigured;
+  }
+
+  inline bool IsEvenParity() const {
+    return config_.load(std::memory_order_relaxed) & kEvenParity;
+  }
+
+  inline bool ParityFor(UBYTE byte) const {
+    auto const config = config_.load(std::memory_order_relaxed);
+    auto const even_parity = (config & kEvenParity) != 0;
+    return ((config & kEnableParity) ? CalculateParity(even_parity, byte)
+                                     : even_parity);
+  }
+
+  inline UBYTE LoadErrors(Player player) const {
+    return players_[player].errors.load(std::memory_order_relaxed);
+  }
+
+  /// The slowest reader's position; everything before it is free.
+  inline Index MinCursor() const {
+    auto const tail = tail_.load(std::memory_order_acquire);
+    Index min = tail;
+    for (Player i = 0; i < n_players_; ++i) {
+      auto const cursor = players_[i].cursor.load(std::memory_order_acquire);
+      if (static_cast<int32_t>(cursor - min) < 0) {
+        min = cursor;
+      }
+    }
+    return min;
+  }
+
+  /// Whether a byte at `tail` would overrun the slowest reader. A stale tail
+  /// can be behind the cursors, which just means it is not full.
+  inline bool IsFull(Index tail) const {
+    return static_cast<int32_t>(tail - MinCursor()) >=
+           static_cast<int32_t>(kBufferSize);
+  }
+
+  inline Slot const *PublishedSlot(Index index) const {
+    auto const &slot = slots_[index & kMask];
+    if (slot.sequence.load(std::memory_order_seq_cst) != index + 1) {
+      return nullptr;
+    }
+    return &slot;
+  }
+
+  inline Slot const *FirstUnreadSlot(Player player) {
+    SkipOwnMessages(player);
+    return PublishedSlot(
+        players_[player].cursor.load(std::memory_order_relaxed));
+  }
+
+  /// Moves the player's cursor over published bytes it sent itself.
+  inline void SkipOwnMessages(Player player) {
+    auto &cursor = players_[player].cursor;
+    auto index = cursor.load(std::memory_order_relaxed);
+    auto const start = index;
+    for (;;) {
+      auto const slot = PublishedSlot(index);
+      if (!slot || slot->sender != player) break;
+      ++index;
+    }
+    if (index != start) {
+      cursor.store(index, std::memory_order_seq_cst);
+    }
+  }
+};
+
+using ConcurrentComLynxClient = BasicComLynxClient<ConcurrentComLynx>;
+
+#endif  // SUPERKODER_COMLYNX_CONCURRENT_H
@@ -0,0 +1,313 @@
+// You are free to use this in any way you like, as long as you mention:
+// ------------------------------------------------------------------------------ 
+// Copyright (c) 2024 superKoder (github.com/superKoder/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The ABOVE COPYRIGHT notice and this permission notice SHALL BE INCLUDED in all
+// copies or substantial portions of the Software.
+//
+// The software is provided "as is", without warranty of any kind, express or
+// implied, including but not limited to the warranties of merchantability,
+// fitness for a particular purpose and noninfringement. In no event shall the
+// authors or copyright holders be liable for any claim, damages or other
+// liability, whether in an action of contract, tort or otherwise, arising from,
+// out of or in connection with the software or the use or other dealings in the
+// software.
+// ------------------------------------------------------------------------------ 
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using ::testing::ElementsAre;
+
+#include "comlynx_concurrent.h"
+
+namespace {
+
+std::vector<UBYTE> ReadAllSuccessfully(ConcurrentComLynx &comlynx,
+                                       ConcurrentComLynx::Player player) {
+    std::vector<UBYTE> ret;
+    while (comlynx.IsRxReady(player)) {
+        ret.push_back(comlynx.Recv(player));
+    }
+    return ret;
+}
+
+}  // namespace
+
+TEST(ConcurrentComLynxTest, test_2p_simpleSend_p1_to_p2) {
+    ConcurrentComLynx comlynx(2);
+    ConcurrentComLynx::TxNotReadyReason reason = {};
+    comlynx.Configure(ComLynx::ParityConfig::kOdd);
+
+    auto const sender = 0;
+    auto const receiver = 1;
+
+    EXPECT_TRUE(comlynx.IsTxEmpty(sender));
+    EXPECT_EQ(comlynx.GetSERCTL(sender), 0b10100000);
+    comlynx.Send(sender, 'A');
+    EXPECT_FALSE(comlynx.IsTxEmpty(sender));
+    EXPECT_TRUE(comlynx.IsTxReady(sender, reason));
+    EXPECT_EQ(comlynx.GetSERCTL(sender), 0b10000000);
+    EXPECT_EQ(comlynx.GetSERCTL(receiver), 0b11100001);
+    comlynx.Send(sender, 'B');
+    comlynx.Send(sender, 'C');
+
+    EXPECT_FALSE(comlynx.IsRxReady(sender));
+    EXPECT_EQ(comlynx.Recv(receiver), 'A');
+    EXPECT_EQ(comlynx.Recv(receiver), 'B');
+    EXPECT_EQ(comlynx.GetSERCTL(receiver), 0b11100000);
+    EXPECT_EQ(comlynx.Recv(receiver), 'C');
+    EXPECT_EQ(comlynx.GetSERCTL(sender), 0b10100000);
+    EXPECT_EQ(comlynx.GetSERCTL(receiver), 0b10100000);
+    EXPECT_TRUE(comlynx.IsTxEmpty(sender));
+}
+
+TEST(ConcurrentComLynxTest, test_handshake_slime_world) {
+    ConcurrentComLynx comlynx(2);
+    comlynx.Configure(ComLynx::ParityConfig::kOdd);
+    ConcurrentComLynxClient L1(comlynx, 0);
+    ConcurrentComLynxClient L2(comlynx, 1);
+
+    for (UBYTE byte : {0x05, 0x00}) EXPECT_TRUE(L1.Send(byte));
+    EXPECT_TRUE(L2.Send(0x05));
+    for (UBYTE byte : {0x00, 0x01}) EXPECT_TRUE(L1.Send(byte));
+    EXPECT_TRUE(L2.Send(0x00));
+    for (UBYTE byte : {0x05, 0x00, 0xF4}) EXPECT_TRUE(L1.Send(byte));
+
+    EXPECT_THAT(ReadAllSuccessfully(comlynx, 1),
+                ElementsAre(0x05, 0x00, 0x00, 0x01, 0x05, 0x00, 0xF4));
+
+    for (UBYTE byte : {0x01, 0x03, 0x05, 0x00, 0xF1}) EXPECT_TRUE(L2.Send(byte));
+
+    EXPECT_THAT(ReadAllSuccessfully(comlynx, 0),
+                ElementsAre(0x05, 0x00, 0x01, 0x03, 0x05, 0x00, 0xF1));
+    EXPECT_TRUE(L1.IsTxEmpty());
+    EXPECT_TRUE(L2.IsTxEmpty());
+}
+
+TEST(ConcurrentComLynxTest, test_overrun_and_break) {
+    ConcurrentComLynx comlynx(3);
+    ConcurrentComLynx::TxNotReadyReason reason = {};
+    comlynx.Configure(ComLynx::ParityConfig::kMark);
+
+    for (size_t i = 0; i < ConcurrentComLynx::kBufferSize; ++i) {
+        EXPECT_TRUE(comlynx.Send(0, UBYTE(i)));
+    }
+    EXPECT_FALSE(comlynx.IsTxReady(2, reason));
+    EXPECT_EQ(reason, ComLynx::TxNotReadyReason::kOverrun);
+    EXPECT_FALSE(comlynx.Send(2, 'X'));
+    EXPECT_TRUE(comlynx.HasOverrunError(2));
+    comlynx.ResetErrors(2);
+
+    // Only one reader done: still full.
+    EXPECT_EQ(ReadAllSuccessfully(comlynx, 1).size(), ConcurrentComLynx::kBufferSize);
+    EXPECT_FALSE(comlynx.IsTxReady(2, reason));
+    EXPECT_EQ(ReadAllSuccessfully(comlynx, 2).size(), ConcurrentComLynx::kBufferSize);
+    EXPECT_TRUE(comlynx.IsTxReady(2, reason));
+    EXPECT_TRUE(comlynx.IsTxEmpty(0));
+
+    comlynx.SendBreak();
+    EXPECT_TRUE(comlynx.IsRxBrk(0));
+    EXPECT_FALSE(comlynx.IsRxBrk(0));
+    EXPECT_TRUE(comlynx.IsRxBrk(2));
+}
+
+TEST(ConcurrentComLynxTest, test_stress_all_talk) {
+    constexpr ConcurrentComLynx::Player kPlayers = 8;
+    constexpr int kBytesEach = 2000;
+
+    ConcurrentComLynx comlynx(kPlayers);
+    comlynx.Configure(ComLynx::ParityConfig::kEven);
+
+    // Every byte is tagged with its sender in the top 3 bits, and its running
+    // count in the low 5 bits.
+    std::vector<std::vector<UBYTE>> received(kPlayers);
+    std::vector<std::thread> threads;
+    for (ConcurrentComLynx::Player p = 0; p < kPlayers; ++p) {
+        threads.emplace_back([&comlynx, &received, p] {
+            ConcurrentComLynxClient client(comlynx, p);
+            auto &inbox = received[p];
+            int sent = 0;
+            while (sent < kBytesEach ||
+                   inbox.size() < size_t(kBytesEach * (kPlayers - 1))) {
+                if (sent < kBytesEach) {
+                    ConcurrentComLynx::TxNotReadyReason reason = {};
+                    if (client.IsTxReady(reason) &&
+                        client.Send(UBYTE(p << 5 | (sent & 0x1F)))) {
+                        ++sent;
+                    }
+                    client.ResetErrors();
+                }
+                while (client.IsRxReady()) {
+                    inbox.push_back(client.Recv());
+                }
+                std::this_thread::yield();
+            }
+            while (!client.IsTxEmpty()) {
+                std::this_thread::yield();
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    for (ConcurrentComLynx::Player p = 0; p < kPlayers; ++p) {
+        // Every other sender's bytes arrive complete and in order.
+        std::vector<int> next(kPlayers, 0);
+        for (auto byte : received[p]) {
+            auto const sender = byte >> 5;
+            ASSERT_NE(sender, p);
+            EXPECT_EQ(byte & 0x1F, next[sender] & 0x1F);
+            ++next[sender];
+        }
+        for (ConcurrentComLynx::Player q = 0; q < kPlayers; ++q) {
+            EXPECT_EQ(next[q], q == p ? 0 : kBytesEach);
+        }
+        EXPECT_FALSE(comlynx.HasAnyError(p));
+    }
+
+    // The cable has one order, and everybody saw it.
+    auto const without = [](std::vector<UBYTE> const &bytes, int a, int b) {
+        std::vector<UBYTE> ret;
+        for (auto byte : bytes) {
+            if ((byte >> 5) != a && (byte >> 5) != b) ret.push_back(byte);
+        }
+        return ret;
+    };
+    for (ConcurrentComLynx::Player p = 1; p < kPlayers; ++p) {
+        EXPECT_EQ(without(received[0], 0, p), without(received[p], 0, p));
+    }
+}
+
+TEST(ConcurrentComLynxTest, test_stress_serctl_polling) {
+    constexpr ConcurrentComLynx::Player kPlayers = 8;
+    constexpr int kBytes = 5000;
+
+    ConcurrentComLynx comlynx(kPlayers);
+    comlynx.Configure(ComLynx::ParityConfig::kOdd);
+
+    std::vector<std::thread> threads;
+    threads.emplace_back([&comlynx] {
+        ConcurrentComLynxClient client(comlynx, 0);
+        for (int sent = 0; sent < kBytes;) {
+            if (client.GetSERCTL() & 0x80) {
+                if (client.Send(UBYTE(sent))) ++sent;
+                client.ResetErrors();
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+    for (ConcurrentComLynx::Player p = 1; p < kPlayers; ++p) {
+        threads.emplace_back([&comlynx, p] {
+            ConcurrentComLynxClient client(comlynx, p);
+            client.EnableRxIRQ(true);
+            for (int expected = 0; expected < kBytes;) {
+                if (client.GetSERCTL() & 0x40) {
+                    EXPECT_TRUE(client.IsIRQ());
+                    EXPECT_EQ(client.Recv(), UBYTE(expected));
+                    ++expected;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+            EXPECT_FALSE(client.HasAnyError());
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    EXPECT_TRUE(comlynx.IsTxEmpty(0));
+}
+
+TEST(ConcurrentComLynxTest, test_wait_times_out) {
+    ConcurrentComLynx comlynx(2);
+    comlynx.Configure(ComLynx::ParityConfig::kOdd);
+    ConcurrentComLynxClient L2(comlynx, 1);
+
+    auto const start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(L2.WaitRx(std::chrono::milliseconds(20)));
+    EXPECT_GE(std::chrono::steady_clock::now() - start,
+              std::chrono::milliseconds(20));
+    EXPECT_TRUE(L2.WaitTxEmpty(std::chrono::milliseconds(20)));
+}
+
+TEST(ConcurrentComLynxTest, test_wait_handshake_slime_world) {
+    ConcurrentComLynx comlynx(2);
+    comlynx.Configure(ComLynx::ParityConfig::kOdd);
+    constexpr auto kTimeout = std::chrono::seconds(10);
+
+    // Both sides block instead of spinning while the other one works.
+    std::thread L2_thread([&comlynx, kTimeout] {
+        ConcurrentComLynxClient L2(comlynx, 1);
+        std::vector<UBYTE> received;
+        while (received.size() < 7 && L2.WaitRx(kTimeout)) {
+            received.push_back(L2.Recv());
+        }
+        EXPECT_THAT(received,
+                    ElementsAre(0x05, 0x00, 0x00, 0x01, 0x05, 0x00, 0xF4));
+        for (UBYTE byte : {0x05, 0x00, 0x01, 0x03, 0x05, 0x00, 0xF1}) {
+            EXPECT_TRUE(L2.Send(byte));
+        }
+        EXPECT_TRUE(L2.WaitTxEmpty(kTimeout));
+    });
+
+    ConcurrentComLynxClient L1(comlynx, 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    for (UBYTE byte : {0x05, 0x00, 0x00, 0x01, 0x05, 0x00, 0xF4}) {
+        EXPECT_TRUE(L1.Send(byte));
+    }
+    EXPECT_TRUE(L1.WaitTxEmpty(kTimeout));
+    std::vector<UBYTE> received;
+    while (received.size() < 7 && L1.WaitRx(kTimeout)) {
+        received.push_back(L1.Recv());
+    }
+    EXPECT_THAT(received,
+                ElementsAre(0x05, 0x00, 0x01, 0x03, 0x05, 0x00, 0xF1));
+    L2_thread.join();
+}
+
+TEST(ConcurrentComLynxTest, test_stress_waiters) {
+    constexpr ConcurrentComLynx::Player kPlayers = 4;
+    constexpr int kBytes = 2000;
+    constexpr auto kTimeout = std::chrono::seconds(10);
+
+    ConcurrentComLynx comlynx(kPlayers);
+    comlynx.Configure(ComLynx::ParityConfig::kOdd);
+
+    std::vector<std::thread> threads;
+    threads.emplace_back([&comlynx, kTimeout] {
+        ConcurrentComLynxClient client(comlynx, 0);
+        for (int sent = 0; sent < kBytes; ++sent) {
+            while (!client.Send(UBYTE(sent))) {
+                client.ResetErrors();
+                ASSERT_TRUE(client.WaitTxEmpty(kTimeout));
+            }
+        }
+        EXPECT_TRUE(client.WaitTxEmpty(kTimeout));
+    });
+    for (ConcurrentComLynx::Player p = 1; p < kPlayers; ++p) {
+        threads.emplace_back([&comlynx, p, kTimeout] {
+            ConcurrentComLynxClient client(comlynx, p);
+            for (int expected = 0; expected < kBytes; ++expected) {
+                ASSERT_TRUE(client.WaitRx(kTimeout));
+                EXPECT_EQ(client.Recv(), UBYTE(expected));
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
@@ -0,0 +1,220 @@
+// You are free to use this in any way you like, as long as you mention:
+// ------------------------------------------------------------------------------
+// Copyright (c) 2024 superKoder (github.com/superKoder/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The ABOVE COPYRIGHT notice and this permission notice SHALL BE INCLUDED in
+// all copies or substantial portions of the Software.
+//
+// The software is provided "as is", without warranty of any kind, express or
+// implied, including but not limited to the warranties of merchantability,
+// fitness for a particular purpose and noninfringement. In no event shall the
+// authors or copyright holders be liable for any claim, damages or other
+// liability, whether in an action of contract, tort or otherwise, arising from,
+// out of or in connection with the software or the use or other dealings in the
+// software.
+// ------------------------------------------------------------------------------
+
+#ifndef SUPERKODER_COMLYNX_FRAMER_H
+#define SUPERKODER_COMLYNX_FRAMER_H
+#pragma once
+
+#include <algorithm>
+#include <array>
+
+#include "comlynx.h"
+#include "comlynx_checksum.h"
+
+/// One packet of the common ComLynx game protocol, as the framer saw it.
+struct ComLynxPacket {
+  /// The bytes between the length byte and the checksum.
+  UBYTE const *payload = nullptr;
+  size_t size = {};
+  /// The checksum byte that came with the packet.
+  UBYTE checksum = {};
+  /// Whether `checksum` matches the length byte and payload.
+  bool valid = {};
+};
+
+/**
+ * Cuts a byte stream into packets of the shape most ComLynx games use: a
+ * length byte N, N payload bytes, and ComLynxCommonChecksum() of the length
+ * byte and payload. Slime World's handshake, `05 00 00 01 05 00 F4`, is one
+ * such packet with a 5-byte payload.
+ *
+ * Every complete packet goes to the callback, valid or not; after a bad one
+ * the framer simply starts over with the next byte.
+ */
+class ComLynxPacketFramer {
+ public:
+  using PacketCallback = void (*)(void *context, ComLynxPacket const &packet);
+
+  static constexpr size_t kMaxPayload = 255;
+
+  constexpr inline void SetPacketCallback(PacketCallback callback,
+                                          void *context) {
+    callback_ = callback;
+    context_ = context;
+  }
+
+  inline void Push(UBYTE byte) {
+    if (!in_packet_) {
+      in_packet_ = true;
+      expected_ = byte;
+      size_ = 0;
+      checksum_.Reset();
+      checksum_.Update(byte);
+      return;
+    }
+    if (size_ < expected_) {
+      payload_[size_++] = byte;
+      checksum_.Update(byte);
+      return;
+    }
+
+    in_packet_ = false;
+    ComLynxPacket packet;
+    packet.payload = payload_.data();
+    packet.size = size_;
+    packet.checksum = byte;
+    packet.valid = byte == checksum_.Checksum();
+    if (packet.valid) {
+      ++packets_;
+    } else {
+      ++corrupt_packets_;
+    }
+    if (callback_) callback_(context_, packet);
+  }
+
+  inline void Push(UBYTE const *data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+      Push(data[i]);
+    }
+  }
+
+  /// Drops a half-received packet, e.g. after a break on the line.
+  constexpr inline void Reset() {
+    in_packet_ = false;
+  }
+
+  /// Whether it is in the middle of a packet.
+  constexpr inline bool IsBusy() const {
+    return in_packet_;
+  }
+
+  constexpr inline uint32_t GetPacketCount() const {
+    return packets_;
+  }
+
+  constexpr inline uint32_t GetCorruptPacketCount() const {
+    return corrupt_packets_;
+  }
+
+ private:
+  PacketCallback callback_ = nullptr;
+  void *context_ = nullptr;
+  bool in_packet_ = false;
+  size_t expected_ = {};
+  size_t size_ = {};
+  ComLynxChecksumAccumulator checksum_;
+  std::array<UBYTE, kMaxPayload> payload_ = {};
+  uint32_t packets_ = {};
+  uint32_t corrupt_packets_ = {};
+};
+
+/**
+ * A ComLynxClient that sends and receives whole packets (see
+ * ComLynxPacketFramer) instead of single bytes.
+ */
+template <typename Client>
+class BasicComLynxPacketClient {
+ public:
+  using PacketCallback = ComLynxPacketFramer::PacketCallback;
+
+  inline explicit BasicComLynxPacketClient(Client &client)
+      : client_{client} {}
+
+  constexpr inline void SetPacketCallback(PacketCallback callback,
+                                          void *context) {
+    framer_.SetPacketCallback(callback, context);
+  }
+
+  /**
+   * Frames `payload` and sends it. A packet that fits on the cable goes out
+   * in one burst, or not at all if the cable is too full right now. A longer
+   * one goes out as the cable drains, from later SendPacket() and Poll()
+   * calls. Returns false, taking nothing, while either is the case.
+   */
+  inline bool SendPacket(UBYTE const *payload, size_t size) {
+    COMLYNX_ASSERT(size <= ComLynxPacketFramer::kMaxPayload);
+    if (!Flush()) return false;
+    auto const length = size + 2;
+    if (length <= ComLynxTypes::kBufferSize &&
+        client_.GetQueuedCount() + length > ComLynxTypes::kBufferSize) {
+      return false;
+    }
+
+    outgoing_[0] = static_cast<UBYTE>(size);
+    std::copy(payload, payload + size, &outgoing_[1]);
+    outgoing_[size + 1] = static_cast<UBYTE>(
+        ComLynxCommonChecksum(payload, size) - static_cast<UBYTE>(size));
+    outgoing_size_ = length;
+    outgoing_sent_ = 0;
+    Flush();
+    return true;
+  }
+
+  /// Sends as much of a long packet as the cable has room for. Returns
+  /// whether the last packet has gone out completely.
+  inline bool Flush() {
+    if (outgoing_sent_ < outgoing_size_) {
+      auto const room = ComLynxTypes::kBufferSize - client_.GetQueuedCount();
+      auto const count = std::min(room, outgoing_size_ - outgoing_sent_);
+      outgoing_sent_ += client_.SendBurst(&outgoing_[outgoing_sent_], count);
+    }
+    return outgoing_sent_ == outgoing_size_;
+  }
+
+  /// Whether part of a long packet is still waiting for the cable.
+  constexpr inline bool IsSending() const {
+    return outgoing_sent_ < outgoing_size_;
+  }
+
+  /// Sends what it can of a long packet, then feeds whatever has arrived to
+  /// the framer, which calls the packet callback for each packet completed.
+  /// A break drops a half-read packet.
+  inline void Poll() {
+    Flush();
+    if (client_.IsRxBrk()) {
+      framer_.Reset();
+    }
+    while (client_.IsRxReady()) {
+      framer_.Push(client_.Recv());
+    }
+  }
+
+  constexpr inline ComLynxPacketFramer const &framer() const {
+    return framer_;
+  }
+
+  constexpr inline Client &client() {
+    return client_;
+  }
+
+ private:
+  Client &client_;
+  ComLynxPacketFramer framer_;
+  std::array<UBYTE, ComLynxPacketFramer::kMaxPayload + 2> outgoing_ = {};
+  size_t outgoing_size_ = {};
+  size_t outgoing_sent_ = {};
+};
+
+using ComLynxPacketClient = BasicComLynxPacketClient<ComLynxClient>;
+
+#endif  // SUPERKODER_COMLYNX_FRAMER_H
@@ -0,0 +1,180 @@
+// You are free to use this in any way you like, as long as you mention:
+// ------------------------------------------------------------------------------ 
+// Copyright (c) 2024 superKoder (github.com/superKoder/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The ABOVE COPYRIGHT notice and this permission notice SHALL BE INCLUDED in all
+// copies or substantial portions of the Software.
+//
+// The software is provided "as is", without warranty of any kind, express or
+// implied, including but not limited to the warranties of merchantability,
+// fitness for a particular purpose and noninfringement. In no event shall the
+// authors or copyright holders be liable for any claim, damages or other
+// liability, whether in an action of contract, tort or otherwise, arising from,
+// out of or in connection with the software or the use or other dealings in the
+// software.
+// ------------------------------------------------------------------------------ 
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <vector>
+
+using ::testing::ElementsAre;
+
+#include "comlynx_framer.h"
+
+namespace {
+
+struct Received {
+    std::vector<UBYTE> payload;
+    UBYTE checksum;
+    bool valid;
+};
+
+void Collect(void *context, ComLynxPacket const &packet) {
+    static_cast<std::vector<Received> *>(context)->push_back(
+        {std::vector<UBYTE>(packet.payload, packet.payload + packet.size),
+         packet.checksum, packet.valid});
+}
+
+}  // namespace
+
+TEST(ComLynxFramerTest, test_slime_world_packets) {
+    std::vector<Received> packets;
+    ComLynxPacketFramer framer;
+    framer.SetPacketCallback(Collect, &packets);
+
+    UBYTE const stream[] = {0x05, 0x00, 0x00, 0x01, 0x05, 0x00, 0xF4,
+                            0x05, 0x00, 0x01, 0x03, 0x05, 0x00, 0xF1};
+    framer.Push(stream, 3);
+    EXPECT_TRUE(framer.IsBusy());
+    EXPECT_TRUE(packets.empty());
+    framer.Push(stream + 3, sizeof(stream) - 3);
+    EXPECT_FALSE(framer.IsBusy());
+
+    ASSERT_EQ(packets.size(), 2u);
+    EXPECT_THAT(packets[0].payload, ElementsAre(0x00, 0x00, 0x01, 0x05, 0x00));
+    EXPECT_EQ(packets[0].checksum, 0xF4);
+    EXPECT_TRUE(packets[0].valid);
+    EXPECT_THAT(packets[1].payload, ElementsAre(0x00, 0x01, 0x03, 0x05, 0x00));
+    EXPECT_TRUE(packets[1].valid);
+    EXPECT_EQ(framer.GetPacketCount(), 2u);
+    EXPECT_EQ(framer.GetCorruptPacketCount(), 0u);
+}
+
+TEST(ComLynxFramerTest, test_flags_corrupt_packets_and_carries_on) {
+    std::vector<Received> packets;
+    ComLynxPacketFramer framer;
+    framer.SetPacketCallback(Collect, &packets);
+
+    // 02 10 20 CD with a flipped payload bit, then a good empty packet.
+    for (UBYTE byte : {0x02, 0x10, 0x21, 0xCD, 0x00, 0xFF}) framer.Push(byte);
+
+    ASSERT_EQ(packets.size(), 2u);
+    EXPECT_FALSE(packets[0].valid);
+    EXPECT_EQ(packets[0].checksum, 0xCD);
+    EXPECT_TRUE(packets[1].valid);
+    EXPECT_TRUE(packets[1].payload.empty());
+    EXPECT_EQ(framer.GetPacketCount(), 1u);
+    EXPECT_EQ(framer.GetCorruptPacketCount(), 1u);
+}
+
+TEST(ComLynxFramerTest, test_packet_clients_over_the_bus) {
+    ComLynx comlynx(3);
+    comlynx.Configure(ComLynx::ParityConfig::kOdd);
+    ComLynxClient L1(comlynx, 0);
+    ComLynxClient L2(comlynx, 1);
+    ComLynxPacketClient P1(L1);
+    ComLynxPacketClient P2(L2);
+    std::vector<Received> at_L1;
+    std::vector<Received> at_L2;
+    P1.SetPacketCallback(Collect, &at_L1);
+    P2.SetPacketCallback(Collect, &at_L2);
+
+    UBYTE const offer[] = {0x00, 0x00, 0x01, 0x05, 0x00};
+    EXPECT_TRUE(P1.SendPacket(offer, sizeof(offer)));
+
+    // What went on the cable is the Slime World packet, byte for byte.
+    std::vector<UBYTE> raw;
+    while (comlynx.IsRxReady(2)) raw.push_back(comlynx.Recv(2));
+    EXPECT_THAT(raw, ElementsAre(0x05, 0x00, 0x00, 0x01, 0x05, 0x00, 0xF4));
+    P2.Poll();
+    ASSERT_EQ(at_L2.size(), 1u);
+    EXPECT_TRUE(at_L2[0].valid);
+    EXPECT_EQ(at_L2[0].checksum, 0xF4);
+    EXPECT_THAT(at_L2[0].payload, ElementsAre(0x00, 0x00, 0x01, 0x05, 0x00));
+
+    // A break in the middle of a packet throws the first half away.
+    L2.Send(0x05);
+    L2.Send(0x00);
+    P1.Poll();
+    L2.SendBreak();
+    UBYTE const answer[] = {0x00, 0x01, 0x03, 0x05, 0x00};
+    EXPECT_TRUE(P2.SendPacket(answer, sizeof(answer)));
+    P1.Poll();
+    while (comlynx.IsRxReady(2)) comlynx.Recv(2);
+    ASSERT_EQ(at_L1.size(), 1u);
+    EXPECT_TRUE(at_L1[0].valid);
+    EXPECT_EQ(at_L1[0].checksum, 0xF1);
+    EXPECT_FALSE(P1.framer().IsBusy());
+}
+
+TEST(ComLynxFramerTest, test_packet_goes_out_whole_or_not_at_all) {
+    ComLynx comlynx(2);
+    comlynx.Configure(ComLynx::ParityConfig::kOdd);
+    ComLynxClient L1(comlynx, 0);
+    ComLynxPacketClient P1(L1);
+
+    // 25 bytes on the cable leave room for 7: a 5-byte payload fits once.
+    UBYTE const offer[] = {0x00, 0x00, 0x01, 0x05, 0x00};
+    for (int i = 0; i < 25; ++i) EXPECT_TRUE(L1.Send(0xEE));
+    EXPECT_TRUE(P1.SendPacket(offer, sizeof(offer)));
+    EXPECT_EQ(comlynx.GetQueuedCount(), ComLynx::kBufferSize);
+
+    EXPECT_FALSE(P1.SendPacket(offer, sizeof(offer)));
+    EXPECT_EQ(comlynx.GetQueuedCount(), ComLynx::kBufferSize);
+    EXPECT_FALSE(L1.HasOverrunError());
+}
+
+TEST(ComLynxFramerTest, test_long_packet_goes_out_as_the_cable_drains) {
+    ComLynx comlynx(2);
+    comlynx.Configure(ComLynx::ParityConfig::kOdd);
+    ComLynxClient L1(comlynx, 0);
+    ComLynxClient L2(comlynx, 1);
+    ComLynxPacketClient P1(L1);
+    ComLynxPacketClient P2(L2);
+    std::vector<Received> at_L2;
+    P2.SetPacketCallback(Collect, &at_L2);
+
+    // 102 bytes on the wire: a full cable now and three more as it drains.
+    std::vector<UBYTE> payload(100);
+    for (size_t i = 0; i < payload.size(); ++i) payload[i] = UBYTE(i * 7);
+    EXPECT_TRUE(P1.SendPacket(payload.data(), payload.size()));
+    EXPECT_TRUE(P1.IsSending());
+    EXPECT_EQ(comlynx.GetQueuedCount(), ComLynx::kBufferSize);
+    EXPECT_FALSE(P1.SendPacket(payload.data(), 1));
+
+    int rounds = 0;
+    while (P1.IsSending()) {
+        P2.Poll();
+        P1.Poll();
+        ++rounds;
+    }
+    P2.Poll();
+    EXPECT_EQ(rounds, 3);
+    EXPECT_FALSE(L1.HasOverrunError());
+    ASSERT_EQ(at_L2.size(), 1u);
+    EXPECT_TRUE(at_L2[0].valid);
+    EXPECT_EQ(at_L2[0].payload, payload);
+
+    // Once it has all gone, the next packet is taken straight away.
+    EXPECT_TRUE(P1.SendPacket(payload.data(), 1));
+    EXPECT_FALSE(P1.IsSending());
+}
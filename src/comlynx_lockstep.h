@@ -0,0 +1,381 @@
+// You are free to use this in any way you like, as long as you mention:
+// ------------------------------------------------------------------------------
+// Copyright (c) 2024 superKoder (github.com/superKoder/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The ABOVE COPYRIGHT notice and this permission notice SHALL BE INCLUDED in
+// all copies or substantial portions of the Software.
+//
+// The software is provided "as is", without warranty of any kind, express or
+// implied, including but not limited to the warranties of merchantability,
+// fitness for a particular purpose and noninfringement. In no event shall the
+// authors or copyright holders be liable for any claim, damages or other
+// liability, whether in an action of contract, tort or otherwise, arising from,
+// out of or in connection with the software or the use or other dealings in the
+// software.
+// ------------------------------------------------------------------------------
+
+#ifndef SUPERKODER_COMLYNX_LOCKSTEP_H
+#define SUPERKODER_COMLYNX_LOCKSTEP_H
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "comlynx.h"
+
+/**
+ * Runs one emulator core per player of a timed ComLynx bus on a pool of
+ * threads, in lockstep, with the same outcome however the threads happen to
+ * be scheduled.
+ *
+ * Time is cut into slices that end at the bus's next possible delivery: the
+ * next byte in flight landing, or one frame time from now, which is the
+ * soonest anything sent during the slice could land. So within a slice no
+ * core can see anything another core does, and the cores run in parallel.
+ *
+ * During a slice a core talks to its Port instead of the bus. The Port hands
+ * out what the player could read when the slice began and keeps what the
+ * core sends. Between slices, on one thread, the scheduler moves newly
+ * readable bytes into each Port (as far as it has room) and puts everything
+ * sent on the bus ordered by time, then by player.
+ */
+class ComLynxLockstep {
+ public:
+  using Player = ComLynx::Player;
+  using Tick = ComLynx::Tick;
+  using TxNotReadyReason = ComLynx::TxNotReadyReason;
+
+  /// One core's end of the cable during a slice.
+  class Port {
+   public:
+    constexpr inline Player GetPlayer() const {
+      return player_;
+    }
+
+    /// The core's own time; Send() stamps bytes with it. Must stay within
+    /// the slice being run.
+    inline void SetTime(Tick now) {
+      COMLYNX_ASSERT(now >= start_ && now < until_);
+      now_ = now;
+    }
+
+    constexpr inline Tick Now() const {
+      return now_;
+    }
+
+    inline bool Send(UBYTE data) {
+      TxNotReadyReason reason = {};
+      auto const ready = IsTxReady(reason);
+      if (ready) {
+        ++sent_count_;
+      } else {
+        errors_.overrun = true;
+      }
+      // Queued either way: the bus turns it down too, and keeps the error.
+      outbox_.push_back({now_, Event::kSend, data});
+      return ready;
+    }
+
+    inline UBYTE Recv() {
+      COMLYNX_ASSERT(IsRxReady());
+      auto const data = inbox_[inbox_head_ % kInboxSize];
+      ++inbox_head_;
+      return data;
+    }
+
+    inline void SendBreak() {
+      outbox_.push_back({now_, Event::kBreak, {}});
+    }
+
+    inline bool IsRxReady() const {
+      return inbox_head_ != inbox_tail_;
+    }
+
+    /// Whether the cable had room when the slice began, counting what this
+    /// core has sent since. Other cores' bytes only count once the slice is
+    /// over, so a crowded cable can still overrun then.
+    inline bool IsTxReady(TxNotReadyReason &reason) const {
+      if (sent_count_ >= tx_room_) {
+        reason = TxNotReadyReason::kOverrun;
+        return false;
+      }
+      return true;
+    }
+
+    inline bool IsTxEmpty() const {
+      return tx_empty_ && sent_count_ == 0;
+    }
+
+    inline bool IsRxBrk() {
+      auto const rx_break = rx_break_;
+      rx_break_ = false;
+      return rx_break;
+    }
+
+    inline bool HasFrameError() const {
+      return errors_.frame;
+    }
+
+    inline bool HasOverrunError() const {
+      return errors_.overrun;
+    }
+
+    inline bool HasParityError() const {
+      return errors_.parity;
+    }
+
+    inline bool HasAnyError() const {
+      return errors_.frame || errors_.overrun || errors_.parity;
+    }
+
+    inline void ResetErrors() {
+      errors_.Reset();
+      outbox_.push_back({now_, Event::kResetErrors, {}});
+    }
+
+   private:
+    friend class ComLynxLockstep;
+
+    /// Room for everything the player could have unread on the cable.
+    static constexpr size_t kInboxSize = ComLynx::kBufferSize;
+
+    struct Event {
+      enum Kind : UBYTE { kSend, kBreak, kResetErrors };
+
+      Tick time;
+      Kind kind;
+      UBYTE data;
+    };
+
+    Player player_ = {};
+    Tick start_ = {};
+    Tick until_ = {};
+    Tick now_ = {};
+    std::array<UBYTE, kInboxSize> inbox_ = {};
+    size_t inbox_head_ = {};
+    size_t inbox_tail_ = {};
+    std::vector<Event> outbox_;
+    size_t tx_room_ = {};
+    size_t sent_count_ = {};
+    bool tx_empty_ = {};
+    bool rx_break_ = {};
+    ComLynx::Error errors_ = {};
+  };
+
+  /// Runs a core from Port::Now() up to (not including) `until`.
+  using RunCallback = void (*)(void *context, Port &port, Tick until);
+
+  /// Schedules cores onto `bus`, which must be configured with a frame time
+  /// and keep its own time: the scheduler moves it with SetTime(), so it
+  /// cannot have a clock attached. `n_workers` threads help the calling
+  /// thread run slices; with 0 it runs every core itself.
+  inline ComLynxLockstep(ComLynx &bus, size_t n_workers)
+      : bus_{bus}
+      , ports_(static_cast<size_t>(bus.GetPlayerCount()))
+      , cores_(static_cast<size_t>(bus.GetPlayerCount())) {
+    COMLYNX_ASSERT(bus.IsTimed());
+    COMLYNX_ASSERT(!bus.HasClock());
+    for (size_t i = 0; i < ports_.size(); ++i) {
+      ports_[i].player_ = static_cast<Player>(i);
+      ports_[i].outbox_.reserve(ComLynx::kBufferSize);
+    }
+    events_.reserve(ports_.size() * ComLynx::kBufferSize);
+    for (size_t i = 0; i < n_workers; ++i) {
+      workers_.emplace_back([this] { WorkerLoop(); });
+    }
+  }
+
+  ComLynxLockstep(ComLynxLockstep const &) = delete;
+  ComLynxLockstep &operator=(ComLynxLockstep const &) = delete;
+
+  inline ~ComLynxLockstep() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    start_slice_.notify_all();
+    for (auto &worker : workers_) {
+      worker.join();
+    }
+  }
+
+  /// Sets the core that drives `player`. Every player needs one.
+  inline void SetCore(Player player, RunCallback run, void *context) {
+    cores_[static_cast<size_t>(player)] = {run, context};
+  }
+
+  /// Runs every core up to `end`, slice by slice.
+  inline void RunUntil(Tick end) {
+    // An attached clock would keep Now() from ever reaching `end`.
+    COMLYNX_ASSERT(!bus_.HasClock());
+    for (auto &core : cores_) {
+      COMLYNX_ASSERT(core.run);
+    }
+    while (bus_.Now() < end) {
+      auto const start = bus_.Now();
+      auto until = std::min(end, start + bus_.GetFrameTime());
+      Tick delivery = {};
+      if (bus_.NextDelivery(delivery)) {
+        until = std::min(until, delivery);
+      }
+      BeginSlice(start, until);
+      RunSlice();
+      EndSlice(until);
+      ++slice_count_;
+    }
+  }
+
+  /// Slices run so far; each one is a barrier for all cores.
+  constexpr inline uint64_t GetSliceCount() const {
+    return slice_count_;
+  }
+
+ private:
+  struct Core {
+    RunCallback run = nullptr;
+    void *context = nullptr;
+  };
+
+  struct SortedEvent {
+    Tick time;
+    Player player;
+    size_t index;
+  };
+
+  ComLynx &bus_;
+  std::vector<Port> ports_;
+  std::vector<Core> cores_;
+  std::vector<SortedEvent> events_;
+  uint64_t slice_count_ = {};
+
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable start_slice_;
+  std::condition_variable slice_done_;
+  uint64_t slice_ = {};
+  size_t busy_workers_ = {};
+  bool stop_ = false;
+  std::atomic<size_t> next_core_{0};
+
+  inline void BeginSlice(Tick start, Tick until) {
+    for (auto &port : ports_) {
+      auto const player = port.player_;
+      port.start_ = start;
+      port.until_ = until;
+      port.now_ = start;
+      port.outbox_.clear();
+      port.sent_count_ = 0;
+
+      // Top up the inbox as far as it has room, oldest first.
+      auto const unread = port.inbox_tail_ - port.inbox_head_;
+      UBYTE bytes[Port::kInboxSize];
+      auto const count =
+          bus_.RecvAvailable(player, bytes, Port::kInboxSize - unread);
+      for (size_t i = 0; i < count; ++i) {
+        port.inbox_[port.inbox_tail_++ % Port::kInboxSize] = bytes[i];
+      }
+
+      port.tx_empty_ = bus_.IsTxEmpty(player);
+      port.rx_break_ = port.rx_break_ || bus_.IsRxBrk(player);
+      port.errors_.frame = bus_.HasFrameError(player);
+      port.errors_.overrun = bus_.HasOverrunError(player);
+      port.errors_.parity = bus_.HasParityError(player);
+    }
+
+    // Every core may count on all of the free room; whoever comes last when
+    // the slice is merged gets the overrun, as it would on the bus.
+    auto const room = ComLynx::kBufferSize - bus_.GetQueuedCount();
+    for (auto &port : ports_) {
+      port.tx_room_ = room;
+    }
+  }
+
+  inline void RunSlice() {
+    next_core_.store(0, std::memory_order_relaxed);
+    if (!workers_.empty()) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++slice_;
+      busy_workers_ = workers_.size();
+    }
+    start_slice_.notify_all();
+    RunCores();
+    if (!workers_.empty()) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      slice_done_.wait(lock, [this] { return busy_workers_ == 0; });
+    }
+  }
+
+  /// Takes cores off the shared counter until they have all run.
+  inline void RunCores() {
+    for (;;) {
+      auto const i = next_core_.fetch_add(1, std::memory_order_relaxed);
+      if (i >= ports_.size()) return;
+      auto &port = ports_[i];
+      cores_[i].run(cores_[i].context, port, port.until_);
+    }
+  }
+
+  inline void WorkerLoop() {
+    uint64_t seen = 0;
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        start_slice_.wait(lock, [this, seen] { return stop_ || slice_ != seen; });
+        if (stop_) return;
+        seen = slice_;
+      }
+      RunCores();
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--busy_workers_ > 0) continue;
+      }
+      slice_done_.notify_one();
+    }
+  }
+
+  inline void EndSlice(Tick until) {
+    events_.clear();
+    for (auto &port : ports_) {
+      for (size_t i = 0; i < port.outbox_.size(); ++i) {
+        events_.push_back({port.outbox_[i].time, port.player_, i});
+      }
+    }
+    std::stable_sort(events_.begin(), events_.end(),
+                     [](SortedEvent const &a, SortedEvent const &b) {
+                       if (a.time != b.time) return a.time < b.time;
+                       return a.player < b.player;
+                     });
+
+    for (auto const &sorted : events_) {
+      auto const &event =
+          ports_[static_cast<size_t>(sorted.player)].outbox_[sorted.index];
+      bus_.SetTime(event.time);
+      switch (event.kind) {
+        case Port::Event::kSend:
+          bus_.Send(sorted.player, event.data);
+          break;
+        case Port::Event::kBreak:
+          bus_.SendBreak();
+          break;
+        case Port::Event::kResetErrors:
+          bus_.ResetErrors(sorted.player);
+          break;
+      }
+    }
+    bus_.SetTime(until);
+  }
+};
+
+#endif  // SUPERKODER_COMLYNX_LOCKSTEP_H
@@ -0,0 +1,178 @@
+// You are free to use this in any way you like, as long as you mention:
+// ------------------------------------------------------------------------------ 
+// Copyright (c) 2024 superKoder (github.com/superKoder/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The ABOVE COPYRIGHT notice and this permission notice SHALL BE INCLUDED in all
+// copies or substantial portions of the Software.
+//
+// The software is provided "as is", without warranty of any kind, express or
+// implied, including but not limited to the warranties of merchantability,
+// fitness for a particular purpose and noninfringement. In no event shall the
+// authors or copyright holders be liable for any claim, damages or other
+// liability, whether in an action of contract, tort or otherwise, arising from,
+// out of or in connection with the software or the use or other dealings in the
+// software.
+// ------------------------------------------------------------------------------ 
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <utility>
+#include <vector>
+
+using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
+
+#include "comlynx_lockstep.h"
+
+namespace {
+
+using Tick = ComLynx::Tick;
+using Entry = std::pair<Tick, UBYTE>;
+
+/// A core that runs at its own pace, logs whatever it reads and sends its
+/// script one byte at a time once it has read `wait_for` bytes.
+struct StubCore {
+    std::vector<UBYTE> script;
+    size_t wait_for = 0;
+    Tick step = 1;
+
+    Tick clock = 0;
+    size_t sent = 0;
+    std::vector<Entry> log;
+
+    static void Run(void *context, ComLynxLockstep::Port &port, Tick until) {
+        auto &core = *static_cast<StubCore *>(context);
+        for (; core.clock < until; core.clock += core.step) {
+            port.SetTime(core.clock);
+            while (port.IsRxReady()) {
+                core.log.push_back({core.clock, port.Recv()});
+            }
+            if (core.log.size() >= core.wait_for &&
+                core.sent < core.script.size() && port.IsTxEmpty()) {
+                EXPECT_TRUE(port.Send(core.script[core.sent++]));
+            }
+        }
+    }
+};
+
+/// Slime World style: P1 offers a packet, everybody else answers once they
+/// have all of it.
+std::vector<std::vector<Entry>> RunSession(size_t n_workers) {
+    ComLynx comlynx(8);
+    comlynx.Configure(ComLynx::ParityConfig::kOdd);
+    comlynx.ConfigureFrameTime(100);
+
+    std::vector<StubCore> cores(8);
+    cores[0].script = {0x05, 0x00, 0x00, 0x01, 0x05, 0x00, 0xF4};
+    cores[0].step = 7;
+    for (size_t i = 1; i < cores.size(); ++i) {
+        cores[i].script = {UBYTE(0x10 + i), UBYTE(i)};
+        cores[i].wait_for = 7;
+        cores[i].step = 7 + i;
+    }
+
+    ComLynxLockstep lockstep(comlynx, n_workers);
+    for (size_t i = 0; i < cores.size(); ++i) {
+        lockstep.SetCore(ComLynx::Player(i), StubCore::Run, &cores[i]);
+    }
+    lockstep.RunUntil(5000);
+    EXPECT_EQ(comlynx.Now(), 5000u);
+    EXPECT_GT(lockstep.GetSliceCount(), 21u);
+
+    std::vector<std::vector<Entry>> logs;
+    for (auto &core : cores) {
+        logs.push_back(std::move(core.log));
+    }
+    return logs;
+}
+
+std::vector<UBYTE> Bytes(std::vector<Entry> const &log) {
+    std::vector<UBYTE> ret;
+    for (auto const &entry : log) {
+        ret.push_back(entry.second);
+    }
+    return ret;
+}
+
+}  // namespace
+
+TEST(ComLynxLockstepTest, test_scripted_session) {
+    auto const logs = RunSession(0);
+
+    // Everybody answers, and everybody else hears every answer.
+    ASSERT_EQ(logs.size(), 8u);
+    EXPECT_EQ(logs[0].size(), 14u);
+    for (size_t i = 1; i < logs.size(); ++i) {
+        auto const bytes = Bytes(logs[i]);
+        ASSERT_EQ(bytes.size(), 19u);
+        EXPECT_THAT(std::vector<UBYTE>(bytes.begin(), bytes.begin() + 7),
+                    ElementsAre(0x05, 0x00, 0x00, 0x01, 0x05, 0x00, 0xF4));
+    }
+
+    // A byte is read no earlier than one frame after the previous one.
+    for (auto const &log : logs) {
+        for (size_t i = 1; i < log.size(); ++i) {
+            EXPECT_GE(log[i].first, log[i - 1].first);
+        }
+    }
+    EXPECT_GE(logs[1][0].first, 100u);
+}
+
+TEST(ComLynxLockstepTest, test_workers_do_not_change_the_outcome) {
+    auto const serial = RunSession(0);
+    for (size_t n_workers : {1, 3, 7}) {
+        for (int round = 0; round < 5; ++round) {
+            auto const parallel = RunSession(n_workers);
+            ASSERT_EQ(parallel.size(), serial.size());
+            for (size_t i = 0; i < serial.size(); ++i) {
+                EXPECT_THAT(parallel[i], ElementsAreArray(serial[i]))
+                    << n_workers << " workers, player " << i;
+            }
+        }
+    }
+}
+
+TEST(ComLynxLockstepTest, test_port_overrun_and_break) {
+    ComLynx comlynx(2);
+    comlynx.Configure(ComLynx::ParityConfig::kOdd);
+    comlynx.ConfigureFrameTime(100);
+
+    struct Flood {
+        bool overrun = false;
+        bool rx_break = false;
+
+        static void Run(void *context, ComLynxLockstep::Port &port, Tick) {
+            auto &flood = *static_cast<Flood *>(context);
+            if (port.GetPlayer() == 0) {
+                // Fill the cable, then one more.
+                while (port.Send(0xAA)) {
+                }
+                flood.overrun = port.HasOverrunError();
+                port.SendBreak();
+            } else {
+                flood.rx_break = flood.rx_break || port.IsRxBrk();
+            }
+        }
+    } sender, receiver;
+
+    ComLynxLockstep lockstep(comlynx, 1);
+    lockstep.SetCore(0, Flood::Run, &sender);
+    lockstep.SetCore(1, Flood::Run, &receiver);
+    lockstep.RunUntil(1);
+
+    // The bus turned the extra byte down as well.
+    EXPECT_TRUE(sender.overrun);
+    EXPECT_TRUE(comlynx.HasOverrunError(0));
+    EXPECT_EQ(comlynx.GetQueuedCount(), ComLynx::kBufferSize);
+
+    lockstep.RunUntil(2);
+    EXPECT_TRUE(receiver.rx_break);
+}
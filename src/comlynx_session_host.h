@@ -0,0 +1,268 @@
+// You are free to use this in any way you like, as long as you mention:
+// ------------------------------------------------------------------------------
+// Copyright (c) 2024 superKoder (github.com/superKoder/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The ABOVE COPYRIGHT notice and this permission notice SHALL BE INCLUDED in
+// all copies or substantial portions of the Software.
+//
+// The software is provided "as is", without warranty of any kind, express or
+// implied, including but not limited to the warranties of merchantability,
+// fitness for a particular purpose and noninfringement. In no event shall the
+// authors or copyright holders be liable for any claim, damages or other
+// liability, whether in an action of contract, tort or otherwise, arising from,
+// out of or in connection with the software or the use or other dealings in the
+// software.
+// ------------------------------------------------------------------------------
+
+#ifndef SUPERKODER_COMLYNX_SESSION_HOST_H
+#define SUPERKODER_COMLYNX_SESSION_HOST_H
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "comlynx.h"
+#include "comlynx_session_pool.h"
+
+/**
+ * Services many independent link sessions (one ComLynx bus each, say one per
+ * lobby) from a fixed set of threads.
+ *
+ * Every session has a home thread that services it each round, so its bus and
+ * clients stay in that thread's caches. A thread that runs out of sessions
+ * takes one from the back of another thread's queue, and the session stays
+ * with its new home from then on, so a few busy lobbies end up spread over
+ * the threads instead of piling up behind one.
+ *
+ * Sessions are opened and closed between rounds, from the thread that runs
+ * them; during a round each service callback only touches its own session.
+ */
+class ComLynxSessionHost {
+ public:
+  using Handle = ComLynxSessionPool::Handle;
+
+  /// Runs one round of a session: its clients, its bus, whatever it needs.
+  using ServiceCallback = void (*)(void *context, ComLynx &bus);
+
+  /// `n_threads` counts the thread that calls RunRound(), so 1 runs every
+  /// session on the caller.
+  inline explicit ComLynxSessionHost(size_t n_threads,
+                                     size_t sessions_per_chunk = 256)
+      : pool_{sessions_per_chunk}, queues_(n_threads) {
+    COMLYNX_ASSERT(n_threads > 0);
+    for (size_t i = 1; i < n_threads; ++i) {
+      workers_.emplace_back([this, i] { WorkerLoop(i); });
+    }
+  }
+
+  ComLynxSessionHost(ComLynxSessionHost const &) = delete;
+  ComLynxSessionHost &operator=(ComLynxSessionHost const &) = delete;
+
+  inline ~ComLynxSessionHost() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    start_round_.notify_all();
+    for (auto &worker : workers_) {
+      worker.join();
+    }
+  }
+
+  /// Starts a session on a fresh (unconfigured) bus for `n_players`.
+  inline Handle Open(ComLynx::Player n_players, ServiceCallback service,
+                     void *context) {
+    COMLYNX_ASSERT(service);
+    auto const handle = pool_.Create(n_players);
+    if (sessions_.size() <= handle.index) {
+      sessions_.resize(pool_.capacity());
+    }
+    auto &session = sessions_[handle.index];
+    session.bus = pool_.Get(handle);
+    session.service = service;
+    session.context = context;
+    session.home = next_home_;
+    next_home_ = (next_home_ + 1) % GetThreadCount();
+    return handle;
+  }
+
+  /// Ends a session. Stale handles are ignored.
+  inline void Close(Handle handle) {
+    if (!pool_.Get(handle)) return;
+    sessions_[handle.index] = {};
+    pool_.Destroy(handle);
+  }
+
+  /// The session's bus, or nullptr if the handle is stale.
+  inline ComLynx *Get(Handle handle) {
+    return pool_.Get(handle);
+  }
+
+  /// The thread that services the session next round (0 is the caller's).
+  inline size_t GetHomeThread(Handle handle) const {
+    COMLYNX_ASSERT(handle.index < sessions_.size());
+    return sessions_[handle.index].home;
+  }
+
+  inline size_t size() const {
+    return pool_.size();
+  }
+
+  inline size_t GetThreadCount() const {
+    return queues_.size();
+  }
+
+  /// Sessions that moved to another thread so far.
+  constexpr inline uint64_t GetStealCount() const {
+    return steal_count_;
+  }
+
+  /// Services every open session once, in parallel.
+  inline void RunRound() {
+    for (auto &queue : queues_) {
+      queue.items.clear();
+    }
+    for (uint32_t i = 0; i < sessions_.size(); ++i) {
+      if (sessions_[i].bus) queues_[sessions_[i].home].items.push_back(i);
+    }
+    for (auto &queue : queues_) {
+      queue.range.store(Pack(0, queue.items.size()),
+                        std::memory_order_relaxed);
+      queue.steals = 0;
+    }
+
+    if (!workers_.empty()) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++round_;
+        busy_workers_ = workers_.size();
+      }
+      start_round_.notify_all();
+    }
+    Work(0);
+    if (!workers_.empty()) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      round_done_.wait(lock, [this] { return busy_workers_ == 0; });
+    }
+
+    for (auto const &queue : queues_) {
+      steal_count_ += queue.steals;
+    }
+  }
+
+ private:
+  struct Session {
+    ComLynx *bus = nullptr;
+    ServiceCallback service = nullptr;
+    void *context = nullptr;
+    size_t home = {};
+  };
+
+  /// One thread's sessions for the round. The owner takes from the front,
+  /// thieves from the back; both ends live in one word so a single CAS
+  /// settles who gets the last one.
+  struct alignas(64) Queue {
+    std::atomic<uint64_t> range{0};
+    std::vector<uint32_t> items;
+    uint64_t steals = {};
+  };
+
+  ComLynxSessionPool pool_;
+  std::vector<Session> sessions_;
+  std::vector<Queue> queues_;
+  size_t next_home_ = {};
+  uint64_t steal_count_ = {};
+
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable start_round_;
+  std::condition_variable round_done_;
+  uint64_t round_ = {};
+  size_t busy_workers_ = {};
+  bool stop_ = false;
+
+  static constexpr inline uint64_t Pack(uint64_t begin, uint64_t end) {
+    return (begin << 32) | end;
+  }
+
+  static inline bool PopFront(Queue &queue, uint32_t &item) {
+    auto range = queue.range.load(std::memory_order_relaxed);
+    for (;;) {
+      auto const begin = range >> 32;
+      auto const end = range & 0xFFFFFFFFu;
+      if (begin >= end) return false;
+      if (queue.range.compare_exchange_weak(range, Pack(begin + 1, end),
+                                            std::memory_order_relaxed)) {
+        item = queue.items[begin];
+        return true;
+      }
+    }
+  }
+
+  static inline bool PopBack(Queue &queue, uint32_t &item) {
+    auto range = queue.range.load(std::memory_order_relaxed);
+    for (;;) {
+      auto const begin = range >> 32;
+      auto const end = range & 0xFFFFFFFFu;
+      if (begin >= end) return false;
+      if (queue.range.compare_exchange_weak(range, Pack(begin, end - 1),
+                                            std::memory_order_relaxed)) {
+        item = queue.items[end - 1];
+        return true;
+      }
+    }
+  }
+
+  inline void Work(size_t self) {
+    auto &own = queues_[self];
+    uint32_t item = {};
+    while (PopFront(own, item)) {
+      Service(item);
+    }
+    for (size_t i = 1; i < queues_.size(); ++i) {
+      auto &victim = queues_[(self + i) % queues_.size()];
+      while (PopBack(victim, item)) {
+        sessions_[item].home = self;
+        ++own.steals;
+        Service(item);
+      }
+    }
+  }
+
+  inline void Service(uint32_t index) {
+    auto const &session = sessions_[index];
+    session.service(session.context, *session.bus);
+  }
+
+  inline void WorkerLoop(size_t self) {
+    uint64_t seen = 0;
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        start_round_.wait(lock,
+                          [this, seen] { return stop_ || round_ != seen; });
+        if (stop_) return;
+        seen = round_;
+      }
+      Work(self);
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--busy_workers_ > 0) continue;
+      }
+      round_done_.notify_one();
+    }
+  }
+};
+
+#endif  // SUPERKODER_COMLYNX_SESSION_HOST_H
@@ -0,0 +1,166 @@
+// You are free to use this in any way you like, as long as you mention:
+// ------------------------------------------------------------------------------ 
+// Copyright (c) 2024 superKoder (github.com/superKoder/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The ABOVE COPYRIGHT notice and this permission notice SHALL BE INCLUDED in all
+// copies or substantial portions of the Software.
+//
+// The software is provided "as is", without warranty of any kind, express or
+// implied, including but not limited to the warranties of merchantability,
+// fitness for a particular purpose and noninfringement. In no event shall the
+// authors or copyright holders be liable for any claim, damages or other
+// liability, whether in an action of contract, tort or otherwise, arising from,
+// out of or in connection with the software or the use or other dealings in the
+// software.
+// ------------------------------------------------------------------------------ 
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "comlynx_session_host.h"
+
+namespace {
+
+/// A lobby of two: P1 sends `load` bytes each round, P2 reads them back and
+/// checksums them. A few lobbies are much busier than the rest.
+struct Lobby {
+    size_t load = 1;
+    uint64_t rounds = 0;
+    uint64_t received = 0;
+    UBYTE checksum = 0;
+
+    static void Service(void *context, ComLynx &bus) {
+        auto &lobby = *static_cast<Lobby *>(context);
+        if (lobby.rounds == 0) bus.Configure(ComLynx::ParityConfig::kOdd);
+        ++lobby.rounds;
+
+        for (size_t sent = 0; sent < lobby.load;) {
+            auto const burst = std::min(lobby.load - sent, ComLynx::kBufferSize);
+            for (size_t i = 0; i < burst; ++i) {
+                bus.Send(0, UBYTE(sent + i));
+            }
+            sent += burst;
+
+            UBYTE bytes[ComLynx::kBufferSize];
+            auto const count = bus.RecvAvailable(1, bytes, sizeof(bytes));
+            for (size_t i = 0; i < count; ++i) {
+                lobby.checksum = UBYTE(lobby.checksum + bytes[i]);
+            }
+            lobby.received += count;
+        }
+    }
+};
+
+/// Runs `n_rounds` over `n_lobbies` and checks every lobby got all of them.
+void RunLoad(size_t n_threads, size_t n_lobbies, int n_rounds) {
+    ComLynxSessionHost host(n_threads);
+    std::vector<Lobby> lobbies(n_lobbies);
+    std::vector<ComLynxSessionHost::Handle> handles;
+    for (size_t i = 0; i < n_lobbies; ++i) {
+        lobbies[i].load = (i % 64 == 0) ? 2000 : 4;
+        handles.push_back(host.Open(2, Lobby::Service, &lobbies[i]));
+    }
+
+    auto const start = std::chrono::steady_clock::now();
+    for (int round = 0; round < n_rounds; ++round) {
+        host.RunRound();
+    }
+    auto const elapsed = std::chrono::steady_clock::now() - start;
+
+    uint64_t total = 0;
+    for (size_t i = 0; i < n_lobbies; ++i) {
+        EXPECT_EQ(lobbies[i].rounds, uint64_t(n_rounds)) << i;
+        EXPECT_EQ(lobbies[i].received, lobbies[i].load * n_rounds) << i;
+        EXPECT_LT(host.GetHomeThread(handles[i]), n_threads);
+        total += lobbies[i].received;
+    }
+    auto const seconds = std::chrono::duration<double>(elapsed).count();
+    ::testing::Test::RecordProperty(
+        "bytes_per_second_" + std::to_string(n_threads),
+        std::to_string(static_cast<uint64_t>(total / seconds)));
+}
+
+}  // namespace
+
+TEST(ComLynxSessionHostTest, test_open_and_close) {
+    ComLynxSessionHost host(1, 2);
+    Lobby a, b, c;
+
+    auto const ha = host.Open(2, Lobby::Service, &a);
+    auto const hb = host.Open(2, Lobby::Service, &b);
+    EXPECT_EQ(host.size(), 2u);
+    ASSERT_NE(host.Get(ha), nullptr);
+    host.RunRound();
+    EXPECT_EQ(a.rounds, 1u);
+    EXPECT_EQ(b.rounds, 1u);
+
+    host.Close(ha);
+    host.Close(ha);  // stale, ignored
+    EXPECT_EQ(host.Get(ha), nullptr);
+    auto const hc = host.Open(2, Lobby::Service, &c);
+    host.RunRound();
+    EXPECT_EQ(a.rounds, 1u);
+    EXPECT_EQ(b.rounds, 2u);
+    EXPECT_EQ(c.rounds, 1u);
+    EXPECT_NE(host.Get(hc), nullptr);
+    EXPECT_NE(host.Get(hb), nullptr);
+}
+
+TEST(ComLynxSessionHostTest, test_idle_thread_steals_and_keeps_session) {
+    ComLynxSessionHost host(2);
+
+    // Thread 0 gets s0 and s2, thread 1 gets s1 and s3. s0 does not finish
+    // before s2 has run, so thread 1 has to take s2 over.
+    struct Blocked {
+        std::atomic<bool> *done;
+        std::atomic<bool> *wait_for;
+
+        static void Service(void *context, ComLynx &) {
+            auto &self = *static_cast<Blocked *>(context);
+            if (self.wait_for) {
+                while (!self.wait_for->load()) {
+                    std::this_thread::yield();
+                }
+            }
+            self.done->store(true);
+        }
+    };
+    std::atomic<bool> done[4] = {};
+    Blocked s0{&done[0], &done[2]};
+    Blocked s1{&done[1], nullptr};
+    Blocked s2{&done[2], nullptr};
+    Blocked s3{&done[3], nullptr};
+    auto const h0 = host.Open(2, Blocked::Service, &s0);
+    host.Open(2, Blocked::Service, &s1);
+    auto const h2 = host.Open(2, Blocked::Service, &s2);
+    host.Open(2, Blocked::Service, &s3);
+    EXPECT_EQ(host.GetHomeThread(h0), 0u);
+    EXPECT_EQ(host.GetHomeThread(h2), 0u);
+
+    host.RunRound();
+    for (auto &flag : done) {
+        EXPECT_TRUE(flag.load());
+    }
+    EXPECT_GE(host.GetStealCount(), 1u);
+    EXPECT_EQ(host.GetHomeThread(h2), 1u);
+}
+
+TEST(ComLynxSessionHostTest, test_load_generator) {
+    // Same work on 1, 2 and 4 threads. The measured rate is recorded for
+    // each; how it scales depends on the cores the test runs on, so see
+    // BM_SessionHost for numbers.
+    for (size_t n_threads : {1, 2, 4}) {
+        RunLoad(n_threads, 1000, 20);
+    }
+}
@@ -0,0 +1,150 @@
+// You are free to use this in any way you like, as long as you mention:
+// ------------------------------------------------------------------------------
+// Copyright (c) 2024 superKoder (github.com/superKoder/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The ABOVE COPYRIGHT notice and this permission notice SHALL BE INCLUDED in
+// all copies or substantial portions of the Software.
+//
+// The software is provided "as is", without warranty of any kind, express or
+// implied, including but not limited to the warranties of merchantability,
+// fitness for a particular purpose and noninfringement. In no event shall the
+// authors or copyright holders be liable for any claim, damages or other
+// liability, whether in an action of contract, tort or otherwise, arising from,
+// out of or in connection with the software or the use or other dealings in the
+// software.
+// ------------------------------------------------------------------------------
+
+#ifndef SUPERKODER_COMLYNX_SESSION_POOL_H
+#define SUPERKODER_COMLYNX_SESSION_POOL_H
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "comlynx.h"
+
+/**
+ * Owns many independent ComLynx buses (one per link session) and recycles
+ * them, so creating and destroying sessions does not go through the heap once
+ * the pool has warmed up.
+ *
+ * Buses live in fixed-size chunks and never move, so a ComLynxClient can keep
+ * a reference for as long as its session lives. Handles carry a generation
+ * count, so a handle to a destroyed session is detected instead of silently
+ * reaching whatever session got the slot next.
+ */
+class ComLynxSessionPool {
+ public:
+  struct Handle {
+    uint32_t index = kInvalidIndex;
+    uint32_t generation = {};
+
+    constexpr inline bool IsValid() const {
+      return index != kInvalidIndex;
+    }
+  };
+
+  inline explicit ComLynxSessionPool(size_t sessions_per_chunk = 256)
+      : sessions_per_chunk_{sessions_per_chunk} {
+    COMLYNX_ASSERT(sessions_per_chunk > 0);
+  }
+
+  ComLynxSessionPool(ComLynxSessionPool const &) = delete;
+  ComLynxSessionPool &operator=(ComLynxSessionPool const &) = delete;
+
+  /// Hands out a fresh (unconfigured) bus for `n_players`.
+  inline Handle Create(ComLynx::Player n_players) {
+    if (free_head_ == kInvalidIndex) {
+      Grow();
+    }
+
+    auto const index = free_head_;
+    auto &slot = SlotAt(index);
+    free_head_ = slot.next_free;
+
+    slot.bus.Reset(n_players);
+    slot.live = true;
+    ++live_count_;
+    return Handle{index, slot.generation};
+  }
+
+  /// Returns the session's bus to the pool. Stale handles are ignored.
+  inline void Destroy(Handle handle) {
+    auto *slot = Lookup(handle);
+    if (!slot) return;
+
+    slot->live = false;
+    ++slot->generation;
+    slot->next_free = free_head_;
+    free_head_ = handle.index;
+    --live_count_;
+  }
+
+  /// The session's bus, or nullptr if the handle is stale.
+  inline ComLynx *Get(Handle handle) {
+    auto *slot = Lookup(handle);
+    return slot ? &slot->bus : nullptr;
+  }
+
+  constexpr inline size_t size() const {
+    return live_count_;
+  }
+
+  inline size_t capacity() const {
+    return chunks_.size() * sessions_per_chunk_;
+  }
+
+  /// Makes sure `n_sessions` can exist without growing the pool.
+  inline void Reserve(size_t n_sessions) {
+    while (capacity() < n_sessions) {
+      Grow();
+    }
+  }
+
+ private:
+  static constexpr uint32_t kInvalidIndex = ~0u;
+
+  struct Slot {
+    ComLynx bus{0};
+    uint32_t generation = {};
+    uint32_t next_free = kInvalidIndex;
+    bool live = false;
+  };
+
+  size_t const sessions_per_chunk_;
+  std::vector<std::unique_ptr<Slot[]>> chunks_;
+  uint32_t free_head_ = kInvalidIndex;
+  size_t live_count_ = {};
+
+  inline Slot &SlotAt(uint32_t index) {
+    return chunks_[index / sessions_per_chunk_][index % sessions_per_chunk_];
+  }
+
+  inline Slot *Lookup(Handle handle) {
+    if (!handle.IsValid() || handle.index >= capacity()) return nullptr;
+    auto &slot = SlotAt(handle.index);
+    if (!slot.live || slot.generation != handle.generation) return nullptr;
+    return &slot;
+  }
+
+  inline void Grow() {
+    auto const first = static_cast<uint32_t>(capacity());
+    chunks_.push_back(std::make_unique<Slot[]>(sessions_per_chunk_));
+
+    // Thread the new slots onto the free list, lowest index first.
+    for (auto i = sessions_per_chunk_; i-- > 0;) {
+      auto const index = first + static_cast<uint32_t>(i);
+      SlotAt(index).next_free = free_head_;
+      free_head_ = index;
+    }
+  }
+};
+
+#endif  // SUPERKODER_COMLYNX_SESSION_POOL_H
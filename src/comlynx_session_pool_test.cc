@@ -0,0 +1,102 @@
+// You are free to use this in any way you like, as long as you mention:
+// ------------------------------------------------------------------------------ 
+// Copyright (c) 2024 superKoder (github.com/superKoder/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The ABOVE COPYRIGHT notice and this permission notice SHALL BE INCLUDED in all
+// copies or substantial portions of the Software.
+//
+// The software is provided "as is", without warranty of any kind, express or
+// implied, including but not limited to the warranties of merchantability,
+// fitness for a particular purpose and noninfringement. In no event shall the
+// authors or copyright holders be liable for any claim, damages or other
+// liability, whether in an action of contract, tort or otherwise, arising from,
+// out of or in connection with the software or the use or other dealings in the
+// software.
+// ------------------------------------------------------------------------------ 
+
+#include <gtest/gtest.h>
+
+#include "comlynx_session_pool.h"
+
+TEST(ComLynxSessionPoolTest, test_create_and_destroy) {
+    ComLynxSessionPool pool(4);
+    EXPECT_EQ(pool.size(), 0u);
+    EXPECT_EQ(pool.capacity(), 0u);
+
+    auto const a = pool.Create(2);
+    auto const b = pool.Create(8);
+    EXPECT_EQ(pool.size(), 2u);
+    EXPECT_EQ(pool.capacity(), 4u);
+    ASSERT_NE(pool.Get(a), nullptr);
+    ASSERT_NE(pool.Get(b), nullptr);
+    EXPECT_NE(pool.Get(a), pool.Get(b));
+    EXPECT_EQ(pool.Get(a)->GetPlayerCount(), 2);
+    EXPECT_EQ(pool.Get(b)->GetPlayerCount(), 8);
+
+    pool.Destroy(a);
+    EXPECT_EQ(pool.size(), 1u);
+    EXPECT_EQ(pool.Get(a), nullptr);
+    pool.Destroy(a);  // stale, ignored
+    EXPECT_EQ(pool.size(), 1u);
+
+    // The slot comes back, but not to the old handle.
+    auto const c = pool.Create(3);
+    EXPECT_EQ(c.index, a.index);
+    EXPECT_EQ(pool.Get(a), nullptr);
+    ASSERT_NE(pool.Get(c), nullptr);
+    EXPECT_EQ(pool.Get(c)->GetPlayerCount(), 3);
+}
+
+TEST(ComLynxSessionPoolTest, test_reused_bus_is_clean) {
+    ComLynxSessionPool pool(1);
+
+    auto const a = pool.Create(2);
+    auto *bus = pool.Get(a);
+    bus->Configure(ComLynx::ParityConfig::kOdd);
+    bus->Send(0, 'A');
+    bus->SendBreak();
+    pool.Destroy(a);
+
+    auto const b = pool.Create(2);
+    EXPECT_EQ(pool.Get(b), bus);
+    bus->Configure(ComLynx::ParityConfig::kOdd);
+    EXPECT_FALSE(bus->IsRxReady(1));
+    EXPECT_TRUE(bus->IsTxEmpty(0));
+    EXPECT_FALSE(bus->IsRxBrk(1));
+}
+
+TEST(ComLynxSessionPoolTest, test_many_sessions) {
+    ComLynxSessionPool pool;
+    std::vector<ComLynxSessionPool::Handle> handles;
+
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 5000; ++i) {
+            auto const handle = pool.Create(2 + i % 7);
+            auto *bus = pool.Get(handle);
+            bus->Configure(ComLynx::ParityConfig::kEven);
+            bus->Send(0, UBYTE(i));
+            handles.push_back(handle);
+        }
+        auto const capacity = pool.capacity();
+        for (auto const &handle : handles) {
+            auto *bus = pool.Get(handle);
+            ASSERT_NE(bus, nullptr);
+            for (ComLynx::Player p = 1; p < bus->GetPlayerCount(); ++p) {
+                EXPECT_TRUE(bus->IsRxReady(p));
+                bus->Recv(p);
+            }
+            EXPECT_TRUE(bus->IsTxEmpty(0));
+            pool.Destroy(handle);
+        }
+        handles.clear();
+        EXPECT_EQ(pool.size(), 0u);
+        EXPECT_EQ(pool.capacity(), capacity);
+    }
+}
@@ -0,0 +1,144 @@
+// You are free to use this in any way you like, as long as you mention:
+// ------------------------------------------------------------------------------
+// Copyright (c) 2024 superKoder (github.com/superKoder/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The ABOVE COPYRIGHT notice and this permission notice SHALL BE INCLUDED in
+// all copies or substantial portions of the Software.
+//
+// The software is provided "as is", without warranty of any kind, express or
+// implied, including but not limited to the warranties of merchantability,
+// fitness for a particular purpose and noninfringement. In no event shall the
+// authors or copyright holders be liable for any claim, damages or other
+// liability, whether in an action of contract, tort or otherwise, arising from,
+// out of or in connection with the software or the use or other dealings in the
+// software.
+// ------------------------------------------------------------------------------
+
+#ifndef SUPERKODER_COMLYNX_SHARED_H
+#define SUPERKODER_COMLYNX_SHARED_H
+#pragma once
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define COMLYNX_HAS_SHM 1
+#endif
+
+#include <atomic>
+#include <cstring>
+#include <new>
+
+#include "comlynx_concurrent.h"
+
+#ifdef COMLYNX_HAS_SHM
+
+/**
+ * A ConcurrentComLynx in a POSIX shared-memory segment, so every Lynx can run
+ * in its own process. One process creates the segment by name and the others
+ * open it; from then on they all talk through the same lock-free ring and
+ * atomic status words, without any system calls.
+ *
+ * The one-thread-per-player rule of ConcurrentComLynx becomes "one thread in
+ * one process per player". The creator unlinks the name when it goes away;
+ * processes that already have it open keep working.
+ */
+class ComLynxSharedMemory {
+ public:
+  using Player = ConcurrentComLynx::Player;
+
+  static_assert(std::atomic<ConcurrentComLynx::Index>::is_always_lock_free &&
+                    std::atomic<UBYTE>::is_always_lock_free &&
+                    std::atomic<bool>::is_always_lock_free,
+                "Atomics in shared memory must be lock-free.");
+
+  /// Creates the segment `name` (e.g. "/lynx-link") holding a fresh bus for
+  /// `n_players`, replacing any segment left behind under that name.
+  inline ComLynxSharedMemory(char const *name, Player n_players)
+      : owner_{true} {
+    COMLYNX_ASSERT(std::strlen(name) < sizeof(name_));
+    std::strcpy(name_, name);
+
+    ::shm_unlink(name);
+    auto const fd = ::shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) return;
+    if (::ftruncate(fd, sizeof(Segment)) == 0) {
+      Map(fd);
+    }
+    ::close(fd);
+    if (!segment_) return;
+
+    new (segment_->bus) ConcurrentComLynx(n_players);
+    segment_->ready.store(kReady, std::memory_order_release);
+  }
+
+  /// Opens the segment another process created under `name`.
+  inline explicit ComLynxSharedMemory(char const *name) {
+    auto const fd = ::shm_open(name, O_RDWR, 0);
+    if (fd < 0) return;
+    struct stat info = {};
+    if (::fstat(fd, &info) == 0 &&
+        static_cast<size_t>(info.st_size) >= sizeof(Segment)) {
+      Map(fd);
+    }
+    ::close(fd);
+    if (segment_ && segment_->ready.load(std::memory_order_acquire) != kReady) {
+      Unmap();
+    }
+  }
+
+  ComLynxSharedMemory(ComLynxSharedMemory const &) = delete;
+  ComLynxSharedMemory &operator=(ComLynxSharedMemory const &) = delete;
+
+  inline ~ComLynxSharedMemory() {
+    Unmap();
+    if (owner_) ::shm_unlink(name_);
+  }
+
+  /// False if the segment could not be created or opened.
+  constexpr inline bool IsOpen() const {
+    return segment_ != nullptr;
+  }
+
+  inline ConcurrentComLynx &bus() {
+    COMLYNX_ASSERT(IsOpen());
+    return *std::launder(reinterpret_cast<ConcurrentComLynx *>(segment_->bus));
+  }
+
+ private:
+  static constexpr uint32_t kReady = 0x434C5953;  // "CLYS"
+
+  struct Segment {
+    /// kReady once the creator has finished constructing the bus.
+    std::atomic<uint32_t> ready;
+    alignas(ConcurrentComLynx) unsigned char bus[sizeof(ConcurrentComLynx)];
+  };
+
+  Segment *segment_ = nullptr;
+  bool owner_ = false;
+  char name_[256] = {};
+
+  inline void Map(int fd) {
+    auto *addr = ::mmap(nullptr, sizeof(Segment), PROT_READ | PROT_WRITE,
+                        MAP_SHARED, fd, 0);
+    if (addr != MAP_FAILED) {
+      segment_ = static_cast<Segment *>(addr);
+    }
+  }
+
+  inline void Unmap() {
+    if (segment_) ::munmap(segment_, sizeof(Segment));
+    segment_ = nullptr;
+  }
+};
+#endif  // COMLYNX_HAS_SHM
+
+#endif  // SUPERKODER_COMLYNX_SHARED_H
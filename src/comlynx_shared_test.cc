@@ -0,0 +1,131 @@
+// You are free to use this in any way you like, as long as you mention:
+// ------------------------------------------------------------------------------ 
+// Copyright (c) 2024 superKoder (github.com/superKoder/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The ABOVE COPYRIGHT notice and this permission notice SHALL BE INCLUDED in all
+// copies or substantial portions of the Software.
+//
+// The software is provided "as is", without warranty of any kind, express or
+// implied, including but not limited to the warranties of merchantability,
+// fitness for a particular purpose and noninfringement. In no event shall the
+// authors or copyright holders be liable for any claim, damages or other
+// liability, whether in an action of contract, tort or otherwise, arising from,
+// out of or in connection with the software or the use or other dealings in the
+// software.
+// ------------------------------------------------------------------------------ 
+
+#include <gtest/gtest.h>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "comlynx_shared.h"
+
+namespace {
+
+std::string SegmentName(char const *test) {
+    return "/comlynx-" + std::string(test) + "-" + std::to_string(::getpid());
+}
+
+/// Reads `count` bytes for the client, sleeping until they arrive and giving
+/// up after a few seconds.
+bool ReadBytes(ConcurrentComLynxClient &client, size_t count,
+               std::vector<UBYTE> &received) {
+    while (received.size() < count) {
+        if (!client.WaitRx(std::chrono::seconds(10))) return false;
+        received.push_back(client.Recv());
+    }
+    return true;
+}
+
+/// Runs `body` in a child process that opens the segment by name; returns
+/// the child's pid. The child exits 0 if `body` returns true.
+template <typename Body>
+pid_t ForkPlayer(std::string const &name, ConcurrentComLynx::Player player,
+                 Body body) {
+    auto const pid = ::fork();
+    if (pid != 0) return pid;
+
+    ComLynxSharedMemory shared(name.c_str());
+    if (!shared.IsOpen()) ::_exit(2);
+    ConcurrentComLynxClient client(shared.bus(), player);
+    ::_exit(body(client) ? 0 : 1);
+}
+
+int WaitForExitCode(pid_t pid) {
+    int status = 0;
+    if (::waitpid(pid, &status, 0) != pid || !WIFEXITED(status)) return -1;
+    return WEXITSTATUS(status);
+}
+
+}  // namespace
+
+TEST(ComLynxSharedMemoryTest, test_open_missing_segment) {
+    ComLynxSharedMemory shared(SegmentName("missing").c_str());
+    EXPECT_FALSE(shared.IsOpen());
+}
+
+TEST(ComLynxSharedMemoryTest, test_two_mappings_see_the_same_bus) {
+    auto const name = SegmentName("mappings");
+    ComLynxSharedMemory created(name.c_str(), 2);
+    ASSERT_TRUE(created.IsOpen());
+    ComLynxSharedMemory opened(name.c_str());
+    ASSERT_TRUE(opened.IsOpen());
+
+    created.bus().Configure(ComLynx::ParityConfig::kOdd);
+    EXPECT_EQ(opened.bus().GetPlayerCount(), 2);
+    EXPECT_TRUE(created.bus().Send(0, 'A'));
+    ASSERT_TRUE(opened.bus().IsRxReady(1));
+    EXPECT_EQ(opened.bus().Recv(1), 'A');
+    EXPECT_TRUE(created.bus().IsTxEmpty(0));
+}
+
+TEST(ComLynxSharedMemoryTest, test_handshake_slime_world_across_processes) {
+    auto const name = SegmentName("slime");
+    ComLynxSharedMemory shared(name.c_str(), 2);
+    ASSERT_TRUE(shared.IsOpen());
+    shared.bus().Configure(ComLynx::ParityConfig::kOdd);
+
+    // Slime World: L1 offers, L2 answers once it has the whole packet.
+    auto const L1 = ForkPlayer(name, 0, [](ConcurrentComLynxClient &client) {
+        for (UBYTE byte : {0x05, 0x00, 0x00, 0x01, 0x05, 0x00, 0xF4}) {
+            if (!client.Send(byte)) return false;
+        }
+        std::vector<UBYTE> received;
+        if (!ReadBytes(client, 7, received)) return false;
+        return received ==
+               std::vector<UBYTE>{0x05, 0x00, 0x01, 0x03, 0x05, 0x00, 0xF1};
+    });
+    auto const L2 = ForkPlayer(name, 1, [](ConcurrentComLynxClient &client) {
+        std::vector<UBYTE> received;
+        if (!ReadBytes(client, 7, received)) return false;
+        if (received !=
+            std::vector<UBYTE>{0x05, 0x00, 0x00, 0x01, 0x05, 0x00, 0xF4}) {
+            return false;
+        }
+        for (UBYTE byte : {0x05, 0x00, 0x01, 0x03, 0x05, 0x00, 0xF1}) {
+            if (!client.Send(byte)) return false;
+        }
+        return true;
+    });
+    ASSERT_GT(L1, 0);
+    ASSERT_GT(L2, 0);
+
+    EXPECT_EQ(WaitForExitCode(L1), 0);
+    EXPECT_EQ(WaitForExitCode(L2), 0);
+    EXPECT_TRUE(shared.bus().IsTxEmpty(0));
+    EXPECT_TRUE(shared.bus().IsTxEmpty(1));
+    EXPECT_FALSE(shared.bus().HasAnyError(0));
+    EXPECT_FALSE(shared.bus().HasAnyError(1));
+}
@@ -0,0 +1,177 @@
+// You are free to use this in any way you like, as long as you mention:
+// ------------------------------------------------------------------------------
+// Copyright (c) 2024 superKoder (github.com/superKoder/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The ABOVE COPYRIGHT notice and this permission notice SHALL BE INCLUDED in
+// all copies or substantial portions of the Software.
+//
+// The software is provided "as is", without warranty of any kind, express or
+// implied, including but not limited to the warranties of merchantability,
+// fitness for a particular purpose and noninfringement. In no event shall the
+// authors or copyright holders be liable for any claim, damages or other
+// liability, whether in an action of contract, tort or otherwise, arising from,
+// out of or in connection with the software or the use or other dealings in the
+// software.
+// ------------------------------------------------------------------------------
+
+#ifndef SUPERKODER_COMLYNX_STATS_H
+#define SUPERKODER_COMLYNX_STATS_H
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Counts how long things took, HdrHistogram style: exact below 16, and from
+ * there on 16 buckets per power of two, so any value it reports is within
+ * 1/16 of what was recorded. Fixed size, never allocates, and two of them
+ * merge by adding up buckets.
+ */
+class ComLynxLatencyHistogram {
+ public:
+  /// Buckets per power of two, as a power of two.
+  static constexpr int kSubBucketBits = 4;
+  /// Anything from 2^kValueBits up is counted as 2^kValueBits - 1.
+  static constexpr int kValueBits = 32;
+  static constexpr uint64_t kMaxValue = (uint64_t{1} << kValueBits) - 1;
+  static constexpr size_t kBucketCount = size_t{kValueBits - kSubBucketBits + 1}
+                                         << kSubBucketBits;
+
+  inline void Record(uint64_t value) {
+    value = std::min(value, kMaxValue);
+    ++buckets_[BucketOf(value)];
+    min_ = count_ ? std::min(min_, value) : value;
+    max_ = std::max(max_, value);
+    ++count_;
+  }
+
+  inline void Merge(ComLynxLatencyHistogram const &other) {
+    if (other.count_ == 0) return;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+      buckets_[i] += other.buckets_[i];
+    }
+    min_ = count_ ? std::min(min_, other.min_) : other.min_;
+    max_ = std::max(max_, other.max_);
+    count_ += other.count_;
+  }
+
+  inline void Reset() {
+    *this = {};
+  }
+
+  constexpr inline uint64_t GetCount() const {
+    return count_;
+  }
+
+  constexpr inline uint64_t GetMin() const {
+    return min_;
+  }
+
+  constexpr inline uint64_t GetMax() const {
+    return max_;
+  }
+
+  /// The value `percentile` (0 to 100) percent of the records are at or
+  /// below, rounded up to the end of its bucket. 0 when empty.
+  inline uint64_t GetValueAtPercentile(double percentile) const {
+    if (count_ == 0) return 0;
+    auto const clamped = std::min(std::max(percentile, 0.0), 100.0);
+    auto rank = static_cast<uint64_t>(clamped / 100.0 * double(count_) + 0.5);
+    rank = std::max<uint64_t>(rank, 1);
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+      seen += buckets_[i];
+      if (seen >= rank) {
+        return std::min(std::max(HighestIn(i), min_), max_);
+      }
+    }
+    return max_;
+  }
+
+  /// Records in the bucket `value` falls in.
+  inline uint64_t GetCountNear(uint64_t value) const {
+    return buckets_[BucketOf(std::min(value, kMaxValue))];
+  }
+
+ private:
+  static constexpr uint64_t kSubBuckets = uint64_t{1} << kSubBucketBits;
+
+  std::array<uint64_t, kBucketCount> buckets_ = {};
+  uint64_t count_ = {};
+  uint64_t min_ = {};
+  uint64_t max_ = {};
+
+  static constexpr inline size_t BucketOf(uint64_t value) {
+    if (value < kSubBuckets) return static_cast<size_t>(value);
+    int magnitude = 0;
+    while ((value >> magnitude) >= 2 * kSubBuckets) {
+      ++magnitude;
+    }
+    // (value >> magnitude) is in [kSubBuckets, 2 * kSubBuckets).
+    return static_cast<size_t>((uint64_t(magnitude) << kSubBucketBits) +
+                               (value >> magnitude));
+  }
+
+  static constexpr inline uint64_t HighestIn(size_t bucket) {
+    if (bucket < kSubBuckets) return bucket;
+    auto const magnitude = (bucket >> kSubBucketBits) - 1;
+    auto const lowest = (kSubBuckets + (bucket & (kSubBuckets - 1)))
+                        << magnitude;
+    return lowest + (uint64_t{1} << magnitude) - 1;
+  }
+};
+
+/// What one player did on the bus since it was reset.
+struct ComLynxPlayerStats {
+  uint64_t bytes_sent = {};
+  uint64_t bytes_received = {};
+  /// Bytes read whose parity bit did not match.
+  uint64_t parity_errors = {};
+  /// Sends turned down because the cable was full.
+  uint64_t overrun_errors = {};
+  /// Sends turned down mid-frame.
+  uint64_t frame_errors = {};
+  /// Ticks from a byte being sent to this player reading it.
+  ComLynxLatencyHistogram latency;
+};
+
+/// Everything a bus counted, copied out by BasicComLynx::GetStats().
+template <int kPlayerSlots>
+struct ComLynxStats {
+  int n_players = {};
+  uint64_t breaks = {};
+  /// Most bytes ever on the cable at once, out of kBufferSize.
+  size_t queue_high_water = {};
+  std::array<ComLynxPlayerStats, kPlayerSlots> players = {};
+
+  inline uint64_t GetBytesSent() const {
+    uint64_t sum = 0;
+    for (int i = 0; i < n_players; ++i) sum += players[i].bytes_sent;
+    return sum;
+  }
+
+  inline uint64_t GetBytesReceived() const {
+    uint64_t sum = 0;
+    for (int i = 0; i < n_players; ++i) sum += players[i].bytes_received;
+    return sum;
+  }
+
+  /// Every player's latency in one histogram.
+  inline ComLynxLatencyHistogram GetLatency() const {
+    ComLynxLatencyHistogram latency;
+    for (int i = 0; i < n_players; ++i) latency.Merge(players[i].latency);
+    return latency;
+  }
+};
+
+#endif  // SUPERKODER_COMLYNX_STATS_H
@@ -0,0 +1,171 @@
+// You are free to use this in any way you like, as long as you mention:
+// ------------------------------------------------------------------------------ 
+// Copyright (c) 2024 superKoder (github.com/superKoder/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The ABOVE COPYRIGHT notice and this permission notice SHALL BE INCLUDED in all
+// copies or substantial portions of the Software.
+//
+// The software is provided "as is", without warranty of any kind, express or
+// implied, including but not limited to the warranties of merchantability,
+// fitness for a particular purpose and noninfringement. In no event shall the
+// authors or copyright holders be liable for any claim, damages or other
+// liability, whether in an action of contract, tort or otherwise, arising from,
+// out of or in connection with the software or the use or other dealings in the
+// software.
+// ------------------------------------------------------------------------------ 
+
+// Built into its own binary with COMLYNX_ENABLE_STATS=1 (see CMakeLists.txt),
+// since the setting changes what a bus looks like.
+
+#include <gtest/gtest.h>
+
+#include "comlynx.h"
+
+static_assert(COMLYNX_ENABLE_STATS, "Build with COMLYNX_ENABLE_STATS=1.");
+
+TEST(ComLynxLatencyHistogramTest, test_empty) {
+    ComLynxLatencyHistogram histogram;
+    EXPECT_EQ(histogram.GetCount(), 0u);
+    EXPECT_EQ(histogram.GetValueAtPercentile(50), 0u);
+}
+
+TEST(ComLynxLatencyHistogramTest, test_small_values_are_exact) {
+    ComLynxLatencyHistogram histogram;
+    for (uint64_t value = 0; value < 16; ++value) {
+        histogram.Record(value);
+    }
+    EXPECT_EQ(histogram.GetCount(), 16u);
+    EXPECT_EQ(histogram.GetMin(), 0u);
+    EXPECT_EQ(histogram.GetMax(), 15u);
+    EXPECT_EQ(histogram.GetValueAtPercentile(50), 7u);
+    EXPECT_EQ(histogram.GetValueAtPercentile(100), 15u);
+    EXPECT_EQ(histogram.GetCountNear(3), 1u);
+}
+
+TEST(ComLynxLatencyHistogramTest, test_large_values_within_a_sixteenth) {
+    ComLynxLatencyHistogram histogram;
+    for (uint64_t value = 1; value < (uint64_t{1} << 30); value = value * 3 + 1) {
+        histogram.Reset();
+        histogram.Record(value);
+        histogram.Record(value + 1);
+        auto const reported = histogram.GetValueAtPercentile(50);
+        EXPECT_GE(reported, value) << value;
+        EXPECT_LE(reported - value, value / 16) << value;
+    }
+
+    // Off the end counts as the largest value.
+    histogram.Reset();
+    histogram.Record(~uint64_t{0});
+    EXPECT_EQ(histogram.GetMax(), ComLynxLatencyHistogram::kMaxValue);
+    EXPECT_EQ(histogram.GetValueAtPercentile(99),
+              ComLynxLatencyHistogram::kMaxValue);
+}
+
+TEST(ComLynxLatencyHistogramTest, test_percentiles_and_merge) {
+    ComLynxLatencyHistogram fast, slow;
+    for (int i = 0; i < 90; ++i) fast.Record(100);
+    for (int i = 0; i < 10; ++i) slow.Record(5000);
+
+    fast.Merge(slow);
+    EXPECT_EQ(fast.GetCount(), 100u);
+    EXPECT_EQ(fast.GetMin(), 100u);
+    EXPECT_EQ(fast.GetMax(), 5000u);
+    EXPECT_NEAR(double(fast.GetValueAtPercentile(50)), 100, 100 / 16);
+    EXPECT_NEAR(double(fast.GetValueAtPercentile(90)), 100, 100 / 16);
+    EXPECT_EQ(fast.GetValueAtPercentile(99), 5000u);
+}
+
+TEST(ComLynxStatsTest, test_counts_bytes_and_latency) {
+    ComLynx comlynx(3);
+    comlynx.Configure(ComLynx::ParityConfig::kOdd);
+    comlynx.ConfigureFrameTime(100);
+
+    UBYTE const packet[] = {0x05, 0x00, 0x00, 0x01, 0x05, 0x00, 0xF4};
+    EXPECT_EQ(comlynx.SendBurst(0, packet, sizeof(packet)), sizeof(packet));
+    comlynx.Send(1, 0x42);
+    comlynx.SendBreak();
+
+    comlynx.SetTime(1000);
+    UBYTE bytes[ComLynx::kBufferSize];
+    EXPECT_EQ(comlynx.RecvAvailable(1, bytes, sizeof(bytes)), 7u);
+    EXPECT_EQ(comlynx.RecvAvailable(2, bytes, sizeof(bytes)), 8u);
+    EXPECT_EQ(comlynx.Recv(0), 0x42);
+
+    ComLynx::Stats stats;
+    ASSERT_TRUE(comlynx.GetStats(stats));
+    EXPECT_EQ(stats.n_players, 3);
+    EXPECT_EQ(stats.players[0].bytes_sent, 7u);
+    EXPECT_EQ(stats.players[1].bytes_sent, 1u);
+    EXPECT_EQ(stats.players[0].bytes_received, 1u);
+    EXPECT_EQ(stats.players[1].bytes_received, 7u);
+    EXPECT_EQ(stats.players[2].bytes_received, 8u);
+    EXPECT_EQ(stats.GetBytesSent(), 8u);
+    EXPECT_EQ(stats.GetBytesReceived(), 16u);
+    EXPECT_EQ(stats.breaks, 1u);
+    EXPECT_EQ(stats.queue_high_water, 8u);
+
+    // Everything was sent at 0 and read at 1000.
+    auto const latency = stats.GetLatency();
+    EXPECT_EQ(latency.GetCount(), 16u);
+    EXPECT_EQ(latency.GetMin(), 1000u);
+    EXPECT_EQ(latency.GetMax(), 1000u);
+    EXPECT_EQ(stats.players[2].latency.GetCount(), 8u);
+}
+
+TEST(ComLynxStatsTest, test_counts_errors) {
+    ComLynx comlynx(2);
+    comlynx.Configure(ComLynx::ParityConfig::kOdd);
+
+    // Fill the cable, then overrun it twice.
+    for (size_t i = 0; i < ComLynx::kBufferSize; ++i) {
+        EXPECT_TRUE(comlynx.Send(0, UBYTE(i)));
+    }
+    EXPECT_FALSE(comlynx.Send(0, 0xFF));
+    UBYTE const more[] = {1, 2, 3};
+    EXPECT_EQ(comlynx.SendBurst(1, more, sizeof(more)), 0u);
+
+    // Switch parity under the queued bytes so each odd-parity byte reads
+    // back wrong.
+    comlynx.Configure(ComLynx::ParityConfig::kEven);
+    UBYTE bytes[ComLynx::kBufferSize];
+    EXPECT_EQ(comlynx.RecvAvailable(1, bytes, sizeof(bytes)),
+              ComLynx::kBufferSize);
+
+    ComLynx::Stats stats;
+    ASSERT_TRUE(comlynx.GetStats(stats));
+    EXPECT_EQ(stats.players[0].overrun_errors, 1u);
+    EXPECT_EQ(stats.players[1].overrun_errors, 1u);
+    EXPECT_EQ(stats.players[1].parity_errors, ComLynx::kBufferSize);
+    EXPECT_EQ(stats.queue_high_water, ComLynx::kBufferSize);
+
+    // Counts start over on demand and on Reset(), but not on Restore().
+    ComLynx::SavedState state;
+    comlynx.Snapshot(state);
+    comlynx.Restore(state);
+    ASSERT_TRUE(comlynx.GetStats(stats));
+    EXPECT_EQ(stats.players[0].overrun_errors, 1u);
+    comlynx.ResetStats();
+    ASSERT_TRUE(comlynx.GetStats(stats));
+    EXPECT_EQ(stats.players[0].overrun_errors, 0u);
+    EXPECT_EQ(stats.queue_high_water, 0u);
+}
+
+TEST(ComLynxStatsTest, test_fixed_bus) {
+    FixedComLynx<2> comlynx;
+    comlynx.Configure(ComLynx::ParityConfig::kOdd);
+    comlynx.Send(0, 'A');
+    comlynx.Recv(1);
+
+    FixedComLynx<2>::Stats stats;
+    static_assert(std::tuple_size<decltype(stats.players)>::value == 2, "");
+    ASSERT_TRUE(comlynx.GetStats(stats));
+    EXPECT_EQ(stats.players[1].bytes_received, 1u);
+    EXPECT_EQ(stats.players[1].latency.GetMax(), 0u);
+}
@@ -24,9 +24,34 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+#include <atomic>
+#include <memory_resource>
+#include <new>
+
 using ::testing::ElementsAre;
 
 #include "comlynx.h"
+#include "comlynx_test_random.h"
+
+// Counts every trip to the global allocator, so tests can prove a code path
+// never makes one.
+static std::atomic<size_t> g_allocations{0};
+
+void *operator new(size_t size) {
+    ++g_allocations;
+    if (void *ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    std::free(ptr);
+}
 
 std::vector<UBYTE> ReadAllSuccessfully(ComLynx &comlynx, ComLynx::Player player) {
     std::vector<UBYTE> ret;
@@ -543,3 +568,730 @@ TEST(ComLynxTest, test_lynxbug_recv_own_sent) {
 
     P2.Recv();  // P1 reads without RxReady!
 }
+
+TEST(ComLynxTest, test_free_after_out_of_order_reads) {
+    ComLynx comlynx(2);
+    comlynx.Configure(ComLynx::ParityConfig::kOdd);
+
+    ComLynxClient P1(comlynx, 0);
+    ComLynxClient P2(comlynx, 1);
+
+    P1.Send('A');
+    P2.Send('B');
+
+    // P1 is done with 'B' before P2 is done with 'A'.
+    EXPECT_EQ(P1.Recv(), 'B');
+    EXPECT_FALSE(P1.IsTxEmpty());
+    EXPECT_FALSE(P2.IsTxEmpty());
+    EXPECT_EQ(P2.Recv(), 'A');
+
+    EXPECT_TRUE(P1.IsTxEmpty());
+    EXPECT_TRUE(P2.IsTxEmpty());
+    EXPECT_FALSE(P1.IsRxReady());
+    EXPECT_FALSE(P2.IsRxReady());
+}
+
+TEST(ComLynxTest, test_ring_buffer_wraps) {
+    ComLynx comlynx(3);
+    ComLynx::TxNotReadyReason reason = {};
+    comlynx.Configure(ComLynx::ParityConfig::kOdd);
+
+    for (int round = 0; round < 5; ++round) {
+        for (size_t i = 0; i < ComLynx::kBufferSize; ++i) {
+            EXPECT_TRUE(comlynx.Send(round % 3, UBYTE(i)));
+        }
+        EXPECT_FALSE(comlynx.IsTxReady(0, reason));
+        EXPECT_EQ(reason, ComLynx::TxNotReadyReason::kOverrun);
+
+        for (ComLynx::Player p = 0; p < 3; ++p) {
+            auto const bytes = ReadAllSuccessfully(comlynx, p);
+            EXPECT_EQ(bytes.size(), p == round % 3 ? 0 : ComLynx::kBufferSize);
+        }
+        EXPECT_TRUE(comlynx.IsTxEmpty(round % 3));
+    }
+}
+
+TEST(ComLynxTest, test_timestamps_from_emulated_time) {
+    ComLynx comlynx(2);
+    comlynx.Configure(ComLynx::ParityConfig::kOdd);
+
+    comlynx.SetTime(100);
+    comlynx.Send(0, 'A');
+    EXPECT_EQ(comlynx.FirstUnreadMessage(1)->timestamp, 100u);
+    comlynx.Recv(1);
+
+    ComLynx::Tick cycles = 12345;
+    comlynx.AttachClock(&cycles);
+    comlynx.Send(0, 'B');
+    cycles += 80;
+    comlynx.Send(0, 'C');
+    EXPECT_EQ(comlynx.FirstUnreadMessage(1)->timestamp, 12345u);
+    comlynx.Recv(1);
+    EXPECT_EQ(comlynx.FirstUnreadMessage(1)->timestamp, 12425u);
+    comlynx.Recv(1);
+
+    comlynx.AttachClock(nullptr);
+    EXPECT_EQ(comlynx.Now(), 100u);
+}
+
+TEST(ComLynxTest, test_frame_ticks) {
+    // 62500 baud from a 1 MHz Timer 4, counted in 16 MHz system ticks.
+    EXPECT_EQ(ComLynxFrameTicks(1, 16), 16u * 2 * 8 * 11);
+    EXPECT_EQ(ComLynxFrameTicks(0, 1), 8u * 11);
+}
+
+TEST(ComLynxTest, test_timed_delivery) {
+    ComLynx comlynx(2);
+    ComLynx::Tick tick = 0;
+    comlynx.Configure(ComLynx::ParityConfig::kOdd);
+    comlynx.ConfigureFrameTime(100);
+
+    EXPECT_FALSE(comlynx.NextDelivery(tick));
+
+    comlynx.SetTime(1000);
+    EXPECT_TRUE(comlynx.Send(0, 'A'));
+    EXPECT_TRUE(comlynx.Send(0, 'B'));  // queued behind 'A' on the cable
+
+    EXPECT_FALSE(comlynx.IsRxReady(1));
+    EXPECT_EQ(comlynx.GetSERCTL(1), 0b10100000);
+    EXPECT_TRUE(comlynx.NextDelivery(tick));
+    EXPECT_EQ(tick, 1100u);
+
+    comlynx.Advance(99);
+    EXPECT_FALSE(comlynx.IsRxReady(1));
+    comlynx.Advance(1);
+    EXPECT_TRUE(comlynx.IsRxReady(1));
+    EXPECT_TRUE(comlynx.NextDelivery(tick));
+    EXPECT_EQ(tick, 1200u);
+    EXPECT_EQ(comlynx.Recv(1), 'A');
+    EXPECT_FALSE(comlynx.IsRxReady(1));
+
+    comlynx.SetTime(tick);
+    EXPECT_FALSE(comlynx.NextDelivery(tick));
+    EXPECT_THAT(ReadAllSuccessfully(comlynx, 1), ElementsAre('B'));
+    EXPECT_TRUE(comlynx.IsTxEmpty(0));
+
+    // An idle cable sends right away again.
+    comlynx.Advance(1000);
+    EXPECT_TRUE(comlynx.Send(1, 'C'));
+    EXPECT_TRUE(comlynx.NextDelivery(tick));
+    EXPECT_EQ(tick, 2300u);
+}
+
+TEST(ComLynxTest, test_independent_buses) {
+    ComLynx two(2);
+    ComLynx three(3);
+    two.Configure(ComLynx::ParityConfig::kOdd);
+    three.Configure(ComLynx::ParityConfig::kOdd);
+
+    two.Send(0, 'A');
+    three.Send(0, 'B');
+
+    EXPECT_EQ(two.Recv(1), 'A');
+    EXPECT_TRUE(two.IsTxEmpty(0));
+
+    EXPECT_EQ(three.Recv(1), 'B');
+    EXPECT_FALSE(three.IsTxEmpty(0));
+    EXPECT_EQ(three.Recv(2), 'B');
+    EXPECT_TRUE(three.IsTxEmpty(0));
+}
+
+TEST(ComLynxTest, test_8p_everyone_talks) {
+    ComLynx comlynx(ComLynx::kMaxPlayers);
+    comlynx.Configure(ComLynx::ParityConfig::kEven);
+
+    // Wrap the ring a few times so every slot sees every sender.
+    for (int round = 0; round < 10; ++round) {
+        for (ComLynx::Player p = 0; p < ComLynx::kMaxPlayers; ++p) {
+            EXPECT_TRUE(comlynx.Send(p, UBYTE(round * 16 + p)));
+        }
+        for (ComLynx::Player p = 0; p < ComLynx::kMaxPlayers; ++p) {
+            EXPECT_FALSE(comlynx.IsTxEmpty(p));
+        }
+        for (ComLynx::Player p = 0; p < ComLynx::kMaxPlayers; ++p) {
+            auto const bytes = ReadAllSuccessfully(comlynx, p);
+            ASSERT_EQ(bytes.size(), size_t(ComLynx::kMaxPlayers - 1));
+            for (auto byte : bytes) {
+                EXPECT_EQ(byte >> 4, round);
+                EXPECT_NE(byte & 0xF, p);
+            }
+            // Bytes leave the cable in order, so nothing is freed until the
+            // last player has caught up.
+            EXPECT_EQ(comlynx.IsTxEmpty(ComLynx::kMaxPlayers - 1),
+                      p == ComLynx::kMaxPlayers - 1);
+        }
+        for (ComLynx::Player p = 0; p < ComLynx::kMaxPlayers; ++p) {
+            EXPECT_TRUE(comlynx.IsTxEmpty(p));
+        }
+        EXPECT_FALSE(comlynx.HasAnyError(round % ComLynx::kMaxPlayers));
+    }
+}
+
+TEST(ComLynxTest, test_no_allocations_in_steady_state) {
+    ComLynx comlynx(ComLynx::kMaxPlayers);
+    comlynx.Configure(ComLynx::ParityConfig::kOdd);
+    ComLynx::TxNotReadyReason reason = {};
+
+    auto const before = g_allocations.load();
+    for (int round = 0; round < 100; ++round) {
+        for (size_t i = 0; i < ComLynx::kBufferSize; ++i) {
+            comlynx.Send(round % ComLynx::kMaxPlayers, UBYTE(i));
+        }
+        comlynx.Send(0, 'X');  // overrun
+        comlynx.SendBreak();
+        for (ComLynx::Player p = 0; p < ComLynx::kMaxPlayers; ++p) {
+            comlynx.GetSERCTL(p);
+            comlynx.IsIRQ(p);
+            comlynx.IsTxReady(p, reason);
+            comlynx.IsTxEmpty(p);
+            comlynx.IsRxBrk(p);
+            while (comlynx.IsRxReady(p)) {
+                comlynx.Recv(p);
+            }
+            comlynx.ResetErrors(p);
+        }
+    }
+    EXPECT_EQ(g_allocations.load(), before);
+
+    // Reusing a bus for the same number of players does not allocate either.
+    comlynx.Reset(ComLynx::kMaxPlayers);
+    EXPECT_EQ(g_allocations.load(), before);
+}
+
+TEST(ComLynxTest, test_memory_resource) {
+    std::array<std::byte, 1024> arena;
+    std::pmr::monotonic_buffer_resource resource(
+        arena.data(), arena.size(), std::pmr::null_memory_resource());
+
+    auto const before = g_allocations.load();
+    ComLynx comlynx(ComLynx::kMaxPlayers, &resource);
+    comlynx.Configure(ComLynx::ParityConfig::kOdd);
+    comlynx.Send(0, 'A');
+    EXPECT_EQ(comlynx.Recv(7), 'A');
+    EXPECT_EQ(g_allocations.load(), before);
+}
+
+TEST(ComLynxTest, test_irq_edges) {
+    struct Edge {
+        ComLynx::Player player;
+        bool level;
+        bool operator==(Edge const &other) const {
+            return player == other.player && level == other.level;
+        }
+    };
+    std::vector<Edge> edges;
+
+    ComLynx comlynx(3);
+    comlynx.Configure(ComLynx::ParityConfig::kOdd);
+    comlynx.SetIRQCallback(
+        [](void *context, ComLynx::Player player, bool level) {
+            static_cast<std::vector<Edge> *>(context)->push_back({player, level});
+        },
+        &edges);
+
+    comlynx.EnableRxIRQ(1, true);
+    comlynx.EnableRxIRQ(2, true);
+    EXPECT_TRUE(edges.empty());
+
+    comlynx.Send(0, 'A');
+    EXPECT_THAT(edges, ElementsAre(Edge{1, true}, Edge{2, true}));
+    EXPECT_FALSE(comlynx.IsIRQ(0));
+    EXPECT_TRUE(comlynx.IsIRQ(1));
+    EXPECT_TRUE(comlynx.IsIRQ(2));
+
+    // Still asserted: no edge.
+    edges.clear();
+    comlynx.Send(0, 'B');
+    EXPECT_TRUE(edges.empty());
+
+    comlynx.Recv(1);
+    comlynx.Recv(1);
+    EXPECT_THAT(edges, ElementsAre(Edge{1, false}));
+    EXPECT_FALSE(comlynx.IsIRQ(1));
+
+    // Transmit IRQ stays up for as long as the cable has room.
+    edges.clear();
+    comlynx.EnableTxIRQ(0, true);
+    EXPECT_THAT(edges, ElementsAre(Edge{0, true}));
+    edges.clear();
+    for (size_t i = 2; i < ComLynx::kBufferSize; ++i) {
+        comlynx.Send(1, UBYTE(i));
+    }
+    EXPECT_THAT(edges, ElementsAre(Edge{0, false}));
+    edges.clear();
+    EXPECT_EQ(comlynx.Recv(2), 'A');  // frees a slot
+    EXPECT_THAT(edges, ElementsAre(Edge{0, true}));
+    EXPECT_TRUE(comlynx.IsIRQ(2));
+}
+
+TEST(ComLynxTest, test_irq_timed_delivery) {
+    ComLynx comlynx(2);
+    comlynx.Configure(ComLynx::ParityConfig::kOdd);
+    comlynx.ConfigureFrameTime(100);
+    comlynx.EnableRxIRQ(1, true);
+
+    int edges = 0;
+    comlynx.SetIRQCallback(
+        [](void *context, ComLynx::Player, bool) { ++*static_cast<int *>(context); },
+        &edges);
+
+    comlynx.Send(0, 'A');
+    EXPECT_FALSE(comlynx.IsIRQ(1));
+    comlynx.Advance(100);
+    EXPECT_TRUE(comlynx.IsIRQ(1));
+    EXPECT_EQ(edges, 1);
+}
+
+TEST(ComLynxTest, test_cached_serctl_tracks_changes) {
+    ComLynx comlynx(4);
+    comlynx.Configure(ComLynx::ParityConfig::kMark);  // half the bytes are bad
+
+    // Rebuilds SERCTL from the individual status calls.
+    auto const expected_serctl = [&comlynx](ComLynx::Player p) {
+        ComLynx::TxNotReadyReason reason = {};
+        auto const rx_ready = comlynx.IsRxReady(p);
+        auto const next = comlynx.FirstUnreadMessage(p);
+        UBYTE byte = 0;
+        byte |= comlynx.IsTxReady(p, reason) ? 0x80 : 0;
+        byte |= rx_ready ? 0x40 : 0;
+        byte |= comlynx.IsTxEmpty(p) ? 0x20 : 0;
+        byte |= comlynx.HasParityError(p) ? 0x10 : 0;
+        byte |= comlynx.HasOverrunError(p) ? 0x08 : 0;
+        byte |= comlynx.HasFrameError(p) ? 0x04 : 0;
+        byte |= (next && next->parity) ? 0x01 : 0;
+        return byte;
+    };
+
+    ComLynxTestRandom random(12345);
+
+    for (int step = 0; step < 2000; ++step) {
+        auto const p = ComLynx::Player(random(4));
+        switch (random(4)) {
+            case 0:
+            case 1:
+                comlynx.Send(p, UBYTE(random(256)));
+                break;
+            case 2:
+                if (comlynx.IsRxReady(p)) comlynx.Recv(p);
+                break;
+            case 3:
+                comlynx.ResetErrors(p);
+                break;
+        }
+        for (ComLynx::Player q = 0; q < 4; ++q) {
+            auto const serctl = comlynx.GetSERCTL(q);
+            EXPECT_EQ(serctl, expected_serctl(q)) << "step " << step;
+            EXPECT_EQ(serctl, comlynx.GetSERCTL(q));
+        }
+    }
+}
+
+TEST(ComLynxTest, test_fixed_handshake_slime_world) {
+    FixedComLynx<2> comlynx;
+    comlynx.Configure(ComLynx::ParityConfig::kOdd);
+    FixedComLynxClient<2> L1(comlynx, 0);
+    FixedComLynxClient<2> L2(comlynx, 1);
+
+    for (UBYTE byte : {0x05, 0x00}) EXPECT_TRUE(L1.Send(byte));
+    EXPECT_TRUE(L2.Send(0x05));
+    for (UBYTE byte : {0x00, 0x01}) EXPECT_TRUE(L1.Send(byte));
+    EXPECT_TRUE(L2.Send(0x00));
+    for (UBYTE byte : {0x05, 0x00, 0xF4}) EXPECT_TRUE(L1.Send(byte));
+
+    std::vector<UBYTE> received;
+    while (L2.IsRxReady()) received.push_back(L2.Recv());
+    EXPECT_THAT(received, ElementsAre(0x05, 0x00, 0x00, 0x01, 0x05, 0x00, 0xF4));
+
+    for (UBYTE byte : {0x01, 0x03, 0x05, 0x00, 0xF1}) EXPECT_TRUE(L2.Send(byte));
+
+    received.clear();
+    while (L1.IsRxReady()) received.push_back(L1.Recv());
+    EXPECT_THAT(received, ElementsAre(0x05, 0x00, 0x01, 0x03, 0x05, 0x00, 0xF1));
+    EXPECT_TRUE(L1.IsTxEmpty());
+    EXPECT_TRUE(L2.IsTxEmpty());
+}
+
+TEST(ComLynxTest, test_fixed_matches_dynamic) {
+    FixedComLynx<3> fixed;
+    ComLynx dynamic(3);
+    fixed.Configure(ComLynx::ParityConfig::kMark);
+    dynamic.Configure(ComLynx::ParityConfig::kMark);
+    fixed.EnableRxIRQ(2, true);
+    dynamic.EnableRxIRQ(2, true);
+
+    ComLynxTestRandom random(777);
+
+    for (int step = 0; step < 1000; ++step) {
+        auto const p = ComLynx::Player(random(3));
+        auto const byte = UBYTE(random(256));
+        switch (random(3)) {
+            case 0:
+            case 1:
+                EXPECT_EQ(fixed.Send(p, byte), dynamic.Send(p, byte));
+                break;
+            case 2:
+                ASSERT_EQ(fixed.IsRxReady(p), dynamic.IsRxReady(p));
+                if (dynamic.IsRxReady(p)) {
+                    EXPECT_EQ(fixed.Recv(p), dynamic.Recv(p));
+                }
+                break;
+        }
+        for (ComLynx::Player q = 0; q < 3; ++q) {
+            EXPECT_EQ(fixed.GetSERCTL(q), dynamic.GetSERCTL(q));
+            EXPECT_EQ(fixed.IsIRQ(q), dynamic.IsIRQ(q));
+        }
+    }
+}
+
+TEST(ComLynxTest, test_fixed_never_allocates) {
+    auto const before = g_allocations.load();
+    FixedComLynx<8> comlynx;
+    comlynx.Configure(ComLynx::ParityConfig::kOdd);
+    comlynx.Send(0, 'A');
+    comlynx.Recv(5);
+    comlynx.Reset(8);
+    EXPECT_EQ(g_allocations.load(), before);
+}
+
+TEST(ComLynxTest, test_snapshot_restore) {
+    ComLynx comlynx(3);
+    comlynx.Configure(ComLynx::ParityConfig::kOdd);
+    comlynx.ConfigureFrameTime(10);
+    comlynx.EnableRxIRQ(1, true);
+    for (UBYTE byte : {'A', 'B', 'C'}) comlynx.Send(0, byte);
+    comlynx.Advance(15);
+    EXPECT_EQ(comlynx.Recv(1), 'A');
+
+    ComLynx::SavedState saved;
+    comlynx.Snapshot(saved);
+    std::array<UBYTE, 3> serctl_before = {};
+    for (ComLynx::Player p = 0; p < 3; ++p) {
+        serctl_before[p] = comlynx.GetSERCTL(p);
+    }
+
+    // Carry on, then roll back.
+    comlynx.Advance(100);
+    EXPECT_EQ(comlynx.Recv(1), 'B');
+    comlynx.SendBreak();
+    comlynx.EnableTxIRQ(2, true);
+    comlynx.Configure(ComLynx::ParityConfig::kEven);
+    comlynx.Restore(saved);
+
+    EXPECT_EQ(comlynx.Now(), 15u);
+    for (ComLynx::Player p = 0; p < 3; ++p) {
+        EXPECT_EQ(comlynx.GetSERCTL(p), serctl_before[p]);
+        EXPECT_FALSE(comlynx.IsRxBrk(p));
+    }
+    EXPECT_FALSE(comlynx.IsIRQ(1));
+    EXPECT_FALSE(comlynx.IsIRQ(2));
+    comlynx.Advance(100);
+    EXPECT_TRUE(comlynx.IsIRQ(1));
+    EXPECT_EQ(ReadAllSuccessfully(comlynx, 1), std::vector<UBYTE>({'B', 'C'}));
+    EXPECT_EQ(ReadAllSuccessfully(comlynx, 2),
+              std::vector<UBYTE>({'A', 'B', 'C'}));
+    EXPECT_TRUE(comlynx.IsTxEmpty(0));
+}
+
+TEST(ComLynxTest, test_snapshot_ring_without_allocating) {
+    FixedComLynx<8> fixed;
+    ComLynx dynamic(8);
+    ComLynx reference(8);
+    fixed.Configure(ComLynx::ParityConfig::kOdd);
+    dynamic.Configure(ComLynx::ParityConfig::kOdd);
+    reference.Configure(ComLynx::ParityConfig::kOdd);
+
+    auto const play_frame = [](auto &comlynx, int frame) {
+        comlynx.Send(frame % 8, UBYTE(frame));
+        comlynx.Recv((frame + 1) % 8);
+    };
+
+    constexpr int kFrames = 8;
+    std::array<ComLynx::SavedState, kFrames> ring;
+    auto const before = g_allocations.load();
+    for (int frame = 0; frame < kFrames; ++frame) {
+        fixed.Snapshot(ring[frame]);
+        play_frame(fixed, frame);
+    }
+
+    // Any frame's state can be picked up again, even by the other flavour.
+    fixed.Restore(ring[3]);
+    dynamic.Restore(ring[3]);
+    EXPECT_EQ(g_allocations.load(), before);
+
+    for (int frame = 0; frame < 3; ++frame) {
+        play_frame(reference, frame);
+    }
+    for (ComLynx::Player p = 0; p < 8; ++p) {
+        EXPECT_EQ(fixed.GetSERCTL(p), reference.GetSERCTL(p));
+        EXPECT_EQ(dynamic.GetSERCTL(p), reference.GetSERCTL(p));
+        EXPECT_EQ(ReadAllSuccessfully(dynamic, p),
+                  ReadAllSuccessfully(reference, p));
+    }
+}
+
+TEST(ComLynxTest, test_serialize_idle_bus_is_small) {
+    ComLynx comlynx(8);
+    comlynx.Configure(ComLynx::ParityConfig::kOdd);
+    comlynx.SetTime(123456789);
+
+    std::array<UBYTE, ComLynx::kMaxSerializedSize> blob;
+    auto const size = comlynx.Serialize(blob.data(), blob.size());
+    EXPECT_GT(size, 0u);
+    EXPECT_LT(size, 100u);
+
+    // The format does not depend on the host's byte order.
+    EXPECT_EQ(blob[0], 'C');
+    EXPECT_EQ(blob[3], ComLynx::kSerializeVersion);
+    EXPECT_EQ(blob[4], 8);
+    EXPECT_EQ(blob[5], 0x03);
+    EXPECT_EQ(blob[6], 0x95);  // 123456789 = 0x75BCD15, as LEB128
+    EXPECT_EQ(blob[7], 0x9A);
+    EXPECT_EQ(blob[8], 0xEF);
+    EXPECT_EQ(blob[9], 0x3A);
+}
+
+TEST(ComLynxTest, test_serialize_in_flight_handshake) {
+    ComLynx comlynx(2);
+    comlynx.Configure(ComLynx::ParityConfig::kOdd);
+    comlynx.ConfigureFrameTime(100);
+    comlynx.SetTime(1000);
+    comlynx.EnableRxIRQ(1, true);
+    ComLynxClient L1(comlynx, 0);
+    ComLynxClient L2(comlynx, 1);
+
+    // Save in the middle of the Slime World handshake.
+    for (UBYTE byte : {0x05, 0x00, 0x00, 0x01}) L1.Send(byte);
+    comlynx.Advance(250);
+    EXPECT_EQ(L2.Recv(), 0x05);
+    comlynx.SendBreak();
+    L1.Send(0x00);
+    L1.Send(0x00);
+    for (int i = 0; i < 40; ++i) L1.Send(0xEE);  // overrun
+    EXPECT_TRUE(L1.HasOverrunError());
+
+    std::array<UBYTE, ComLynx::kMaxSerializedSize> blob;
+    auto const size = comlynx.Serialize(blob.data(), blob.size());
+    ASSERT_GT(size, 0u);
+    EXPECT_EQ(comlynx.Serialize(blob.data(), size - 1), 0u);
+
+    ComLynx loaded(2);
+    ASSERT_TRUE(loaded.Deserialize(blob.data(), size));
+    EXPECT_EQ(loaded.Now(), comlynx.Now());
+    for (ComLynx::Player p = 0; p < 2; ++p) {
+        EXPECT_EQ(loaded.GetSERCTL(p), comlynx.GetSERCTL(p));
+        EXPECT_EQ(loaded.IsIRQ(p), comlynx.IsIRQ(p));
+    }
+    ComLynx::Tick next_original = 0, next_loaded = 0;
+    EXPECT_TRUE(comlynx.NextDelivery(next_original));
+    EXPECT_TRUE(loaded.NextDelivery(next_loaded));
+    EXPECT_EQ(next_loaded, next_original);
+
+    comlynx.Advance(100000);
+    loaded.Advance(100000);
+    EXPECT_EQ(ReadAllSuccessfully(loaded, 1), ReadAllSuccessfully(comlynx, 1));
+    EXPECT_TRUE(loaded.IsTxEmpty(0));
+}
+
+TEST(ComLynxTest, test_deserialize_rejects_bad_data) {
+    ComLynx comlynx(2);
+    comlynx.Configure(ComLynx::ParityConfig::kOdd);
+    comlynx.Send(0, 'A');
+    std::array<UBYTE, ComLynx::kMaxSerializedSize> blob;
+    auto const size = comlynx.Serialize(blob.data(), blob.size());
+
+    ComLynx other(2);
+    other.Configure(ComLynx::ParityConfig::kEven);
+    for (size_t cut = 0; cut < size; ++cut) {
+        EXPECT_FALSE(other.Deserialize(blob.data(), cut));
+    }
+    auto bad_version = blob;
+    bad_version[3] = ComLynx::kSerializeVersion + 1;
+    EXPECT_FALSE(other.Deserialize(bad_version.data(), size));
+
+    ComLynx three(3);
+    EXPECT_FALSE(three.Deserialize(blob.data(), size));
+
+    // Reader counts and cursors have to agree with each other: header (6),
+    // three times (3), two players (4), count (1), then the queued byte.
+    auto const p0_cursor = 10;
+    auto const readers = 16;
+    ASSERT_EQ(blob[readers], 1);
+    for (UBYTE tampered : {0, 2}) {
+        auto bad_readers = blob;
+        bad_readers[readers] = tampered;
+        EXPECT_FALSE(other.Deserialize(bad_readers.data(), size));
+    }
+    auto waits_on_itself = blob;
+    ASSERT_EQ(blob[p0_cursor], 1);
+    waits_on_itself[p0_cursor] = 0;
+    EXPECT_FALSE(other.Deserialize(waits_on_itself.data(), size));
+
+    // None of that touched the bus.
+    EXPECT_FALSE(other.IsRxReady(1));
+    EXPECT_TRUE(other.Deserialize(blob.data(), size));
+    EXPECT_EQ(other.Recv(1), 'A');
+}
+
+TEST(ComLynxTest, test_burst_handshake_slime_world) {
+    ComLynx comlynx(2);
+    comlynx.Configure(ComLynx::ParityConfig::kOdd);
+    ComLynxClient L1(comlynx, 0);
+    ComLynxClient L2(comlynx, 1);
+
+    UBYTE const offer[] = {
+        0x05, 0x00, 0x00, 0x01, 0x05, 0x00,
+        ComLynxCommonChecksum({0x05, 0x00, 0x00, 0x01, 0x05, 0x00})};
+    EXPECT_EQ(L1.SendBurst(offer, sizeof(offer)), sizeof(offer));
+    EXPECT_FALSE(L1.IsTxEmpty());
+
+    std::array<UBYTE, 16> received = {};
+    EXPECT_EQ(L2.RecvAvailable(received.data(), 3), 3u);
+    EXPECT_EQ(L2.RecvAvailable(received.data() + 3, received.size() - 3), 4u);
+    EXPECT_TRUE(std::equal(std::begin(offer), std::end(offer), received.begin()));
+    EXPECT_TRUE(L1.IsTxEmpty());
+    EXPECT_EQ(L2.RecvAvailable(received.data(), received.size()), 0u);
+    EXPECT_FALSE(L2.HasAnyError());
+}
+
+TEST(ComLynxTest, test_burst_overrun) {
+    ComLynx comlynx(2);
+    comlynx.Configure(ComLynx::ParityConfig::kOdd);
+
+    std::array<UBYTE, 40> bytes = {};
+    EXPECT_EQ(comlynx.SendBurst(0, bytes.data(), 30), 30u);
+    EXPECT_FALSE(comlynx.HasOverrunError(0));
+    EXPECT_EQ(comlynx.SendBurst(0, bytes.data(), 10), 2u);
+    EXPECT_TRUE(comlynx.HasOverrunError(0));
+    EXPECT_EQ(comlynx.SendBurst(1, bytes.data(), 1), 0u);
+    EXPECT_TRUE(comlynx.HasOverrunError(1));
+}
+
+TEST(ComLynxTest, test_burst_matches_single_bytes) {
+    ComLynx burst(3);
+    ComLynx single(3);
+    for (auto *comlynx : {&burst, &single}) {
+        comlynx->Configure(ComLynx::ParityConfig::kEven);
+        comlynx->ConfigureFrameTime(7);
+        comlynx->EnableRxIRQ(2, true);
+    }
+
+    ComLynxTestRandom random(99);
+
+    std::array<UBYTE, 40> bytes = {};
+    std::array<UBYTE, 40> from_burst = {};
+    for (int step = 0; step < 2000; ++step) {
+        auto const p = ComLynx::Player(random(3));
+        auto const n = size_t(random(12));
+        switch (random(4)) {
+            case 0: {
+                for (size_t i = 0; i < n; ++i) bytes[i] = UBYTE(random(256));
+                size_t sent = 0;
+                for (size_t i = 0; i < n; ++i) sent += single.Send(p, bytes[i]);
+                EXPECT_EQ(burst.SendBurst(p, bytes.data(), n), sent);
+                break;
+            }
+            case 1: {
+                auto const read = burst.RecvAvailable(p, from_burst.data(), n);
+                size_t i = 0;
+                for (; i < n && single.IsRxReady(p); ++i) {
+                    EXPECT_EQ(from_burst[i], single.Recv(p));
+                }
+                EXPECT_EQ(read, i);
+                break;
+            }
+            case 2:
+                burst.Advance(n * 3);
+                single.Advance(n * 3);
+                break;
+            case 3:
+                burst.ResetErrors(p);
+                single.ResetErrors(p);
+                break;
+        }
+        for (ComLynx::Player q = 0; q < 3; ++q) {
+            ASSERT_EQ(burst.GetSERCTL(q), single.GetSERCTL(q)) << "step " << step;
+            ASSERT_EQ(burst.IsIRQ(q), single.IsIRQ(q)) << "step " << step;
+        }
+    }
+}
+
+TEST(ComLynxTest, test_generation_only_moves_on_change) {
+    ComLynx comlynx(3);
+    comlynx.Configure(ComLynx::ParityConfig::kOdd);
+    comlynx.ConfigureFrameTime(10);
+    comlynx.EnableRxIRQ(1, true);
+
+    auto last = comlynx.GetGeneration();
+    auto const changed = [&comlynx, &last]() {
+        auto const now = comlynx.GetGeneration();
+        auto const ret = now != last;
+        last = now;
+        return ret;
+    };
+    auto const poll_everyone = [&comlynx]() {
+        ComLynx::TxNotReadyReason reason = {};
+        for (ComLynx::Player p = 0; p < 3; ++p) {
+            comlynx.IsRxReady(p);
+            comlynx.IsTxReady(p, reason);
+            comlynx.IsTxEmpty(p);
+            comlynx.IsIRQ(p);
+            comlynx.GetSERCTL(p);
+        }
+    };
+
+    // A quiet cable stays quiet, however much time passes.
+    poll_everyone();
+    EXPECT_FALSE(changed());
+    comlynx.Advance(1000);
+    comlynx.SetTime(5000);
+    poll_everyone();
+    EXPECT_FALSE(changed());
+
+    comlynx.Send(0, 'A');
+    EXPECT_TRUE(changed());
+    poll_everyone();
+    EXPECT_FALSE(changed());
+
+    // The byte landing is a change; time passing after that is not.
+    comlynx.Advance(10);
+    EXPECT_TRUE(changed());
+    poll_everyone();
+    EXPECT_FALSE(changed());
+    comlynx.Recv(1);
+    EXPECT_TRUE(changed());
+    comlynx.Recv(2);
+    EXPECT_TRUE(changed());
+    comlynx.Advance(100);
+    EXPECT_FALSE(changed());
+
+    comlynx.SendBreak();
+    EXPECT_TRUE(changed());
+    EXPECT_TRUE(comlynx.IsRxBrk(1));
+    EXPECT_TRUE(changed());
+    EXPECT_FALSE(comlynx.IsRxBrk(1));
+    EXPECT_FALSE(changed());
+
+    comlynx.EnableTxIRQ(2, true);
+    EXPECT_TRUE(changed());
+    comlynx.ResetErrors(0);
+    EXPECT_TRUE(changed());
+    comlynx.Configure(ComLynx::ParityConfig::kEven);
+    EXPECT_TRUE(changed());
+
+    // Even Reset never takes it back to a value a host has seen.
+    auto const before_reset = comlynx.GetGeneration();
+    comlynx.Reset(3);
+    EXPECT_GT(comlynx.GetGeneration(), before_reset);
+}
+
+#if !COMLYNX_ENABLE_STATS
+TEST(ComLynxTest, test_stats_compiled_out) {
+    // Nothing is kept per bus for them (see comlynx_stats_test.cc).
+    ComLynx comlynx(2);
+    comlynx.Configure(ComLynx::ParityConfig::kOdd);
+    comlynx.Send(0, 'A');
+    ComLynx::Stats stats;
+    EXPECT_FALSE(comlynx.GetStats(stats));
+    EXPECT_EQ(stats.GetBytesSent(), 0u);
+}
+#endif  // !COMLYNX_ENABLE_STATS
@@ -0,0 +1,47 @@
+// You are free to use this in any way you like, as long as you mention:
+// ------------------------------------------------------------------------------ 
+// Copyright (c) 2024 superKoder (github.com/superKoder/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The ABOVE COPYRIGHT notice and this permission notice SHALL BE INCLUDED in all
+// copies or substantial portions of the Software.
+//
+// The software is provided "as is", without warranty of any kind, express or
+// implied, including but not limited to the warranties of merchantability,
+// fitness for a particular purpose and noninfringement. In no event shall the
+// authors or copyright holders be liable for any claim, damages or other
+// liability, whether in an action of contract, tort or otherwise, arising from,
+// out of or in connection with the software or the use or other dealings in the
+// software.
+// ------------------------------------------------------------------------------ 
+
+#ifndef SUPERKODER_COMLYNX_TEST_RANDOM_H
+#define SUPERKODER_COMLYNX_TEST_RANDOM_H
+#pragma once
+
+#include <cstdint>
+
+/// A tiny LCG for the randomized tests and benchmark inputs: the same numbers
+/// on every platform and standard library, so a failing sequence can be
+/// replayed.
+class ComLynxTestRandom {
+ public:
+  constexpr inline explicit ComLynxTestRandom(uint32_t seed) : seed_{seed} {}
+
+  /// A number in [0, n).
+  constexpr inline uint32_t operator()(uint32_t n) {
+    seed_ = seed_ * 1103515245u + 12345u;
+    return (seed_ >> 16) % n;
+  }
+
+ private:
+  uint32_t seed_;
+};
+
+#endif  // SUPERKODER_COMLYNX_TEST_RANDOM_H
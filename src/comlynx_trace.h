@@ -0,0 +1,648 @@
+// You are free to use this in any way you like, as long as you mention:
+// ------------------------------------------------------------------------------
+// Copyright (c) 2024 superKoder (github.com/superKoder/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The ABOVE COPYRIGHT notice and this permission notice SHALL BE INCLUDED in
+// all copies or substantial portions of the Software.
+//
+// The software is provided "as is", without warranty of any kind, express or
+// implied, including but not limited to the warranties of merchantability,
+// fitness for a particular purpose and noninfringement. In no event shall the
+// authors or copyright holders be liable for any claim, damages or other
+// liability, whether in an action of contract, tort or otherwise, arising from,
+// out of or in connection with the software or the use or other dealings in the
+// software.
+// ------------------------------------------------------------------------------
+
+#ifndef SUPERKODER_COMLYNX_TRACE_H
+#define SUPERKODER_COMLYNX_TRACE_H
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define COMLYNX_HAS_MMAP 1
+#endif
+
+#include "comlynx.h"
+
+/**
+ * The ComLynx trace format: what crossed a bus, so a session can be replayed
+ * offline.
+ *
+ * A trace is an 8-byte header ("CLYT", version, 3 reserved bytes) followed by
+ * events, back to back, with nothing that needs fixing up after loading, so a
+ * file can be read straight from an mmap. Each event starts with a tag byte:
+ *
+ *   bits 0-2  the Kind
+ *   bit  3    a time delta follows
+ *   bits 4-7  the player, or 15 if the player follows as a varint
+ *
+ * then the escaped player if any, the time delta if any (LEB128 varint, ticks
+ * since the previous event, or since zero for a Reset), and the payload: one
+ * data byte for sends and receives, one flags byte for Configure, a varint for
+ * Reset and FrameTime, nothing for a break, and a Control code for the rest
+ * (followed by the new absolute time for kRewind). Most events on an untimed
+ * bus are two bytes.
+ *
+ * Deltas never go negative: when the host sets the clock back (say, after
+ * restoring a snapshot), the writer puts a kRewind in front of the event.
+ */
+struct ComLynxTrace {
+  using Tick = ComLynxTypes::Tick;
+  using Player = ComLynxTypes::Player;
+
+  static constexpr UBYTE kMagic[4] = {'C', 'L', 'Y', 'T'};
+  /// Version 2 added kControl; version 1 traces read the same.
+  static constexpr UBYTE kVersion = 2;
+  static constexpr size_t kHeaderSize = 8;
+
+  enum class Kind : UBYTE {
+    kReset = 0,
+    kConfigure,
+    kFrameTime,
+    kSend,
+    /// A Send that the bus refused (overrun).
+    kSendRejected,
+    kRecv,
+    kBreak,
+    /// Anything else that changes the bus; see Control.
+    kControl,
+  };
+
+  /// What a kControl event did, in its data byte.
+  enum class Control : UBYTE {
+    kRxIRQOff = 0,
+    kRxIRQOn,
+    kTxIRQOff,
+    kTxIRQOn,
+    kResetErrors,
+    /// IsRxBrk() reported (and cleared) a break.
+    kBreakSeen,
+    /// The clock was set back; `value` is the new time.
+    kRewind,
+  };
+
+  struct Event {
+    Kind kind = {};
+    Tick time = {};
+    Player player = {};
+    UBYTE data = {};
+    /// Player count (kReset), frame ticks (kFrameTime), parity flags
+    /// (kConfigure: bit 0 enable, bit 1 even), or the time (kRewind).
+    uint64_t value = {};
+  };
+
+  static constexpr UBYTE kKindMask = 0x07;
+  static constexpr UBYTE kHasTime = 0x08;
+  static constexpr int kPlayerShift = 4;
+  static constexpr Player kPlayerEscape = 15;
+};
+
+/**
+ * Appends events to an in-memory trace. Recording an event is a few stores
+ * into a byte vector; Flush() hands what has piled up to a file.
+ */
+class ComLynxTraceWriter {
+ public:
+  using Tick = ComLynxTrace::Tick;
+  using Player = ComLynxTrace::Player;
+  using Kind = ComLynxTrace::Kind;
+
+  inline explicit ComLynxTraceWriter(size_t reserve_bytes = 64 * 1024) {
+    bytes_.reserve(reserve_bytes);
+    bytes_.insert(bytes_.end(), std::begin(ComLynxTrace::kMagic),
+                  std::end(ComLynxTrace::kMagic));
+    bytes_.push_back(ComLynxTrace::kVersion);
+    bytes_.resize(ComLynxTrace::kHeaderSize, 0);
+  }
+
+  inline void Record(Kind kind, Tick time, Player player, UBYTE data = {},
+                     uint64_t value = {}) {
+    // A reset bus starts its clock over, so resets carry absolute time.
+    if (kind == Kind::kReset) last_time_ = 0;
+    if (time < last_time_) {
+      PutTag(Kind::kControl, 0, false);
+      bytes_.push_back(static_cast<UBYTE>(ComLynxTrace::Control::kRewind));
+      PutVarint(time);
+      last_time_ = time;
+    }
+    auto const delta = time - last_time_;
+    last_time_ = time;
+
+    PutTag(kind, player, delta != 0);
+    if (delta) PutVarint(delta);
+
+    switch (kind) {
+      case Kind::kSend:
+      case Kind::kSendRejected:
+      case Kind::kRecv:
+      case Kind::kControl:
+        bytes_.push_back(data);
+        break;
+      case Kind::kConfigure:
+        bytes_.push_back(static_cast<UBYTE>(value));
+        break;
+      case Kind::kReset:
+      case Kind::kFrameTime:
+        PutVarint(value);
+        break;
+      case Kind::kBreak:
+        break;
+    }
+  }
+
+  /// Everything recorded since construction or the last Flush().
+  inline UBYTE const *data() const {
+    return bytes_.data();
+  }
+
+  inline size_t size() const {
+    return bytes_.size();
+  }
+
+  /// Writes out what has been recorded and forgets it, so a long session
+  /// can stream to `file` with bounded memory. Returns false on I/O errors.
+  inline bool Flush(std::FILE *file) {
+    auto const ok = std::fwrite(bytes_.data(), 1, bytes_.size(), file) ==
+                    bytes_.size();
+    bytes_.clear();
+    return ok;
+  }
+
+ private:
+  std::vector<UBYTE> bytes_;
+  Tick last_time_ = {};
+
+  /// The tag byte and, if it does not fit in there, the player.
+  inline void PutTag(Kind kind, Player player, bool has_time) {
+    auto const escaped = player < 0 || player >= ComLynxTrace::kPlayerEscape;
+    auto tag = static_cast<UBYTE>(kind);
+    tag |= has_time ? ComLynxTrace::kHasTime : 0;
+    tag |= (escaped ? ComLynxTrace::kPlayerEscape : player)
+           << ComLynxTrace::kPlayerShift;
+    bytes_.push_back(tag);
+    if (escaped) PutVarint(static_cast<uint64_t>(player));
+  }
+
+  inline void PutVarint(uint64_t value) {
+    while (value >= 0x80) {
+      bytes_.push_back(static_cast<UBYTE>(value | 0x80));
+      value >>= 7;
+    }
+    bytes_.push_back(static_cast<UBYTE>(value));
+  }
+};
+
+/**
+ * Walks the events of a trace in place; the bytes can come from a
+ * ComLynxTraceWriter, a file read into memory, or a ComLynxTraceMapping.
+ */
+class ComLynxTraceReader {
+ public:
+  using Event = ComLynxTrace::Event;
+  using Kind = ComLynxTrace::Kind;
+
+  inline ComLynxTraceReader(UBYTE const *data, size_t size)
+      : pos_{data}
+      , end_{data + size} {
+    valid_ = size >= ComLynxTrace::kHeaderSize &&
+             std::memcmp(data, ComLynxTrace::kMagic, 4) == 0 &&
+             data[4] >= 1 && data[4] <= ComLynxTrace::kVersion;
+    if (valid_) pos_ += ComLynxTrace::kHeaderSize;
+  }
+
+  /// False if the header is wrong or an event was cut off.
+  constexpr inline bool IsValid() const {
+    return valid_;
+  }
+
+  constexpr inline bool AtEnd() const {
+    return !valid_ || pos_ == end_;
+  }
+
+  /// Decodes the next event. Returns false at the end or on a bad event.
+  inline bool Next(Event &event) {
+    if (AtEnd()) return false;
+
+    auto const tag = *pos_++;
+    auto const kind = static_cast<Kind>(tag & ComLynxTrace::kKindMask);
+    if (kind > Kind::kControl) return Fail();
+
+    event.kind = kind;
+    event.player = tag >> ComLynxTrace::kPlayerShift;
+    event.data = {};
+    event.value = {};
+
+    uint64_t value = 0;
+    if (event.player == ComLynxTrace::kPlayerEscape) {
+      if (!GetVarint(value)) return Fail();
+      event.player = static_cast<ComLynxTrace::Player>(value);
+    }
+    if (kind == Kind::kReset) time_ = 0;
+    if (tag & ComLynxTrace::kHasTime) {
+      if (!GetVarint(value)) return Fail();
+      time_ += value;
+    }
+    event.time = time_;
+
+    switch (kind) {
+      case Kind::kSend:
+      case Kind::kSendRejected:
+      case Kind::kRecv:
+      case Kind::kConfigure:
+        if (pos_ == end_) return Fail();
+        event.data = *pos_++;
+        event.value = event.data;
+        break;
+      case Kind::kReset:
+      case Kind::kFrameTime:
+        if (!GetVarint(event.value)) return Fail();
+        break;
+      case Kind::kBreak:
+        break;
+      case Kind::kControl:
+        if (pos_ == end_) return Fail();
+        event.data = *pos_++;
+        if (event.data > static_cast<UBYTE>(ComLynxTrace::Control::kRewind)) {
+          return Fail();
+        }
+        if (event.data == static_cast<UBYTE>(ComLynxTrace::Control::kRewind)) {
+          if (!GetVarint(event.value)) return Fail();
+          time_ = event.value;
+          event.time = time_;
+        }
+        break;
+    }
+    return true;
+  }
+
+ private:
+  UBYTE const *pos_;
+  UBYTE const *end_;
+  ComLynxTrace::Tick time_ = {};
+  bool valid_ = false;
+
+  inline bool Fail() {
+    valid_ = false;
+    return false;
+  }
+
+  inline bool GetVarint(uint64_t &value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      if (pos_ == end_) return false;
+      auto const byte = *pos_++;
+      value |= uint64_t{byte & 0x7Fu} << shift;
+      if (!(byte & 0x80)) return true;
+    }
+    return false;
+  }
+};
+
+#ifdef COMLYNX_HAS_MMAP
+/// A trace file mapped read-only into memory, for ComLynxTraceReader.
+class ComLynxTraceMapping {
+ public:
+  inline explicit ComLynxTraceMapping(char const *path) {
+    auto const fd = ::open(path, O_RDONLY);
+    if (fd < 0) return;
+    struct stat info = {};
+    if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+      auto *addr = ::mmap(nullptr, static_cast<size_t>(info.st_size),
+                          PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr != MAP_FAILED) {
+        data_ = static_cast<UBYTE const *>(addr);
+        size_ = static_cast<size_t>(info.st_size);
+      }
+    }
+    ::close(fd);
+  }
+
+  ComLynxTraceMapping(ComLynxTraceMapping const &) = delete;
+  ComLynxTraceMapping &operator=(ComLynxTraceMapping const &) = delete;
+
+  inline ~ComLynxTraceMapping() {
+    if (data_) ::munmap(const_cast<UBYTE *>(data_), size_);
+  }
+
+  constexpr inline bool IsOpen() const {
+    return data_ != nullptr;
+  }
+
+  constexpr inline UBYTE const *data() const {
+    return data_;
+  }
+
+  constexpr inline size_t size() const {
+    return size_;
+  }
+
+  inline ComLynxTraceReader Reader() const {
+    return ComLynxTraceReader(data_, size_);
+  }
+
+ private:
+  UBYTE const *data_ = nullptr;
+  size_t size_ = {};
+};
+#endif  // COMLYNX_HAS_MMAP
+
+/**
+ * A bus that records the calls made through it into a ComLynxTraceWriter
+ * and otherwise behaves exactly like the `Bus` it wraps, so it can stand in
+ * for it, e.g. `BasicComLynxClient<ComLynxRecorder>`. It records resets,
+ * configuration, sends, reads, breaks, IRQ enables and error resets.
+ *
+ * It does not see what is done to the wrapped bus directly, such as
+ * Restore(), Deserialize() or AttachClock(), nor the parity errors that
+ * IsRxReady() and RecvAvailable() flag; a trace of a session that relies on
+ * those will not replay.
+ *
+ * Attach it before the bus is configured: the trace starts with the bus's
+ * player count and replays from a fresh bus.
+ */
+template <typename Bus>
+class BasicComLynxRecorder {
+ public:
+  using Player = typename Bus::Player;
+  using Tick = typename Bus::Tick;
+  using ParityConfig = typename Bus::ParityConfig;
+  using TxNotReadyReason = typename Bus::TxNotReadyReason;
+  using Kind = ComLynxTrace::Kind;
+  using Control = ComLynxTrace::Control;
+
+  inline BasicComLynxRecorder(Bus &bus, ComLynxTraceWriter &trace)
+      : bus_{bus}
+      , trace_{trace} {
+    Record(Kind::kReset, 0, {}, bus_.GetPlayerCount());
+  }
+
+  constexpr inline Bus &bus() {
+    return bus_;
+  }
+
+  inline void Reset(Player n_players) {
+    bus_.Reset(n_players);
+    Record(Kind::kReset, 0, {}, static_cast<uint64_t>(n_players));
+  }
+
+  constexpr inline Player GetPlayerCount() const {
+    return bus_.GetPlayerCount();
+  }
+
+  inline void Configure(bool enable_parity, bool even_parity) {
+    bus_.Configure(enable_parity, even_parity);
+    Record(Kind::kConfigure, 0, {},
+           (enable_parity ? 1u : 0u) | (even_parity ? 2u : 0u));
+  }
+
+  inline void Configure(ParityConfig config) {
+    switch (config) {
+      case ParityConfig::kOdd:
+        Configure(true, false);
+        return;
+      case ParityConfig::kEven:
+        Configure(true, true);
+        return;
+      case ParityConfig::kSpace:
+        Configure(false, false);
+        return;
+      case ParityConfig::kMark:
+        Configure(false, true);
+        return;
+    }
+  }
+
+  inline void SetTime(Tick now) {
+    bus_.SetTime(now);
+  }
+
+  inline void Advance(Tick ticks) {
+    bus_.Advance(ticks);
+  }
+
+  constexpr inline Tick Now() const {
+    return bus_.Now();
+  }
+
+  inline void ConfigureFrameTime(Tick frame_ticks) {
+    bus_.ConfigureFrameTime(frame_ticks);
+    Record(Kind::kFrameTime, 0, {}, frame_ticks);
+  }
+
+  inline void EnableRxIRQ(Player player, bool value) {
+    bus_.EnableRxIRQ(player, value);
+    RecordControl(value ? Control::kRxIRQOn : Control::kRxIRQOff, player);
+  }
+
+  inline void EnableTxIRQ(Player player, bool value) {
+    bus_.EnableTxIRQ(player, value);
+    RecordControl(value ? Control::kTxIRQOn : Control::kTxIRQOff, player);
+  }
+
+  inline bool Send(Player player, UBYTE data) {
+    auto const sent = bus_.Send(player, data);
+    Record(sent ? Kind::kSend : Kind::kSendRejected, player, data);
+    return sent;
+  }
+
+  inline UBYTE Recv(Player player) {
+    auto const data = bus_.Recv(player);
+    Record(Kind::kRecv, player, data);
+    return data;
+  }
+
+  /// Recorded byte by byte, as the Send() calls it stands for: what did not
+  /// fit shows up as rejected sends.
+  inline size_t SendBurst(Player player, UBYTE const *data, size_t size) {
+    auto const sent = bus_.SendBurst(player, data, size);
+    for (size_t i = 0; i < size; ++i) {
+      Record(i < sent ? Kind::kSend : Kind::kSendRejected, player, data[i]);
+    }
+    return sent;
+  }
+
+  inline size_t RecvAvailable(Player player, UBYTE *out, size_t capacity) {
+    auto const count = bus_.RecvAvailable(player, out, capacity);
+    for (size_t i = 0; i < count; ++i) {
+      Record(Kind::kRecv, player, out[i]);
+    }
+    return count;
+  }
+
+  inline void SendBreak() {
+    bus_.SendBreak();
+    Record(Kind::kBreak, 0);
+  }
+
+  inline bool IsRxReady(Player player) {
+    return bus_.IsRxReady(player);
+  }
+
+  inline bool IsTxReady(Player player, TxNotReadyReason &reason) const {
+    return bus_.IsTxReady(player, reason);
+  }
+
+  inline bool IsTxEmpty(Player player) const {
+    return bus_.IsTxEmpty(player);
+  }
+
+  inline bool IsRxBrk(Player player) {
+    auto const rx_break = bus_.IsRxBrk(player);
+    if (rx_break) RecordControl(Control::kBreakSeen, player);
+    return rx_break;
+  }
+
+  inline bool IsIRQ(Player player) {
+    return bus_.IsIRQ(player);
+  }
+
+  inline bool HasFrameError(Player player) const {
+    return bus_.HasFrameError(player);
+  }
+
+  inline bool HasOverrunError(Player player) const {
+    return bus_.HasOverrunError(player);
+  }
+
+  inline bool HasParityError(Player player) const {
+    return bus_.HasParityError(player);
+  }
+
+  inline bool HasAnyError(Player player) const {
+    return bus_.HasAnyError(player);
+  }
+
+  inline void ResetErrors(Player player) {
+    bus_.ResetErrors(player);
+    RecordControl(Control::kResetErrors, player);
+  }
+
+  inline UBYTE GetSERCTL(Player player) {
+    return bus_.GetSERCTL(player);
+  }
+
+  /// Reading it changes nothing, so it is not recorded.
+  constexpr inline uint64_t GetGeneration() const {
+    return bus_.GetGeneration();
+  }
+
+ private:
+  Bus &bus_;
+  ComLynxTraceWriter &trace_;
+
+  inline void Record(Kind kind, Player player, UBYTE data = {},
+                     uint64_t value = {}) {
+    trace_.Record(kind, bus_.Now(), player, data, value);
+  }
+
+  inline void RecordControl(Control control, Player player) {
+    Record(Kind::kControl, player, static_cast<UBYTE>(control));
+  }
+};
+
+using ComLynxRecorder = BasicComLynxRecorder<ComLynx>;
+using ComLynxRecorderClient = BasicComLynxClient<ComLynxRecorder>;
+
+/**
+ * Drives `bus` through the events in `trace` as fast as it can, checking that
+ * every Send succeeds or fails and every Recv returns the same as when it was
+ * recorded. Returns false at the first event that turns out differently, or if
+ * the trace is damaged; `events` counts the events replayed before that.
+ */
+template <typename Bus>
+inline bool ReplayComLynxTrace(ComLynxTraceReader &trace, Bus &bus,
+                               size_t &events) {
+  using Kind = ComLynxTrace::Kind;
+  using Control = ComLynxTrace::Control;
+
+  events = 0;
+  ComLynxTrace::Event event;
+  while (trace.Next(event)) {
+    // A damaged or foreign trace must not reach past the bus's players.
+    if (event.kind == Kind::kReset) {
+      if (event.value > static_cast<uint64_t>(Bus::kMaxPlayers)) return false;
+      if (!Bus::kIsDynamic &&
+          event.value != static_cast<uint64_t>(bus.GetPlayerCount())) {
+        return false;
+      }
+    }
+    auto const per_player =
+        event.kind == Kind::kSend || event.kind == Kind::kSendRejected ||
+        event.kind == Kind::kRecv ||
+        (event.kind == Kind::kControl &&
+         static_cast<Control>(event.data) != Control::kRewind);
+    if (per_player &&
+        (event.player < 0 || event.player >= bus.GetPlayerCount())) {
+      return false;
+    }
+    if (event.time != bus.Now()) bus.SetTime(event.time);
+
+    switch (event.kind) {
+      case Kind::kReset:
+        bus.Reset(static_cast<typename Bus::Player>(event.value));
+        break;
+      case Kind::kConfigure:
+        bus.Configure(event.value & 1, event.value & 2);
+        break;
+      case Kind::kFrameTime:
+        bus.ConfigureFrameTime(event.value);
+        break;
+      case Kind::kSend:
+        if (!bus.Send(event.player, event.data)) return false;
+        break;
+      case Kind::kSendRejected:
+        if (bus.Send(event.player, event.data)) return false;
+        break;
+      case Kind::kRecv:
+        // Not IsRxReady(), which could flag a parity error the session never
+        // had.
+        if (!bus.FirstUnreadMessage(event.player)) return false;
+        if (bus.Recv(event.player) != event.data) return false;
+        break;
+      case Kind::kBreak:
+        bus.SendBreak();
+        break;
+      case Kind::kControl: {
+        auto const control = static_cast<Control>(event.data);
+        switch (control) {
+          case Control::kRxIRQOff:
+          case Control::kRxIRQOn:
+            bus.EnableRxIRQ(event.player, control == Control::kRxIRQOn);
+            break;
+          case Control::kTxIRQOff:
+          case Control::kTxIRQOn:
+            bus.EnableTxIRQ(event.player, control == Control::kTxIRQOn);
+            break;
+          case Control::kResetErrors:
+            bus.ResetErrors(event.player);
+            break;
+          case Control::kBreakSeen:
+            if (!bus.IsRxBrk(event.player)) return false;
+            break;
+          case Control::kRewind:
+            break;
+        }
+        break;
+      }
+    }
+    ++events;
+  }
+  return trace.IsValid();
+}
+
+#endif  // SUPERKODER_COMLYNX_TRACE_H
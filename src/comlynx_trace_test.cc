@@ -0,0 +1,290 @@
+// You are free to use this in any way you like, as long as you mention:
+// ------------------------------------------------------------------------------ 
+// Copyright (c) 2024 superKoder (github.com/superKoder/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The ABOVE COPYRIGHT notice and this permission notice SHALL BE INCLUDED in all
+// copies or substantial portions of the Software.
+//
+// The software is provided "as is", without warranty of any kind, express or
+// implied, including but not limited to the warranties of merchantability,
+// fitness for a particular purpose and noninfringement. In no event shall the
+// authors or copyright holders be liable for any claim, damages or other
+// liability, whether in an action of contract, tort or otherwise, arising from,
+// out of or in connection with the software or the use or other dealings in the
+// software.
+// ------------------------------------------------------------------------------ 
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <cstdio>
+#include <vector>
+
+using ::testing::ElementsAre;
+
+#include "comlynx_trace.h"
+
+namespace {
+
+/// Records the Slime World handshake (see test_handshake_slime_world).
+void RecordSlimeWorld(ComLynx &comlynx, ComLynxTraceWriter &trace) {
+    ComLynxRecorder recorder(comlynx, trace);
+    recorder.Configure(ComLynx::ParityConfig::kOdd);
+    ComLynxRecorderClient L1(recorder, 0);
+    ComLynxRecorderClient L2(recorder, 1);
+
+    for (UBYTE byte : {0x05, 0x00}) L1.Send(byte);
+    comlynx.Advance(100);
+    L2.Send(0x05);
+    for (UBYTE byte : {0x00, 0x01}) L1.Send(byte);
+    L2.Send(0x00);
+    for (UBYTE byte : {0x05, 0x00, 0xF4}) L1.Send(byte);
+    comlynx.Advance(100000);
+    while (L2.IsRxReady()) L2.Recv();
+    for (UBYTE byte : {0x01, 0x03, 0x05, 0x00, 0xF1}) L2.Send(byte);
+    while (L1.IsRxReady()) L1.Recv();
+    recorder.SendBreak();
+}
+
+std::vector<ComLynxTrace::Event> Decode(UBYTE const *data, size_t size) {
+    std::vector<ComLynxTrace::Event> events;
+    ComLynxTraceReader reader(data, size);
+    ComLynxTrace::Event event;
+    while (reader.Next(event)) events.push_back(event);
+    EXPECT_TRUE(reader.IsValid());
+    return events;
+}
+
+}  // namespace
+
+TEST(ComLynxTraceTest, test_events_round_trip) {
+    ComLynxTraceWriter trace;
+    using Kind = ComLynxTrace::Kind;
+    trace.Record(Kind::kReset, 0, 0, {}, 300);
+    trace.Record(Kind::kConfigure, 0, 0, {}, 3);
+    trace.Record(Kind::kSend, 7, 299, 0xAB);
+    trace.Record(Kind::kRecv, 1ull << 40, 14, 0xAB);
+    trace.Record(Kind::kSendRejected, 1ull << 40, 15, 0xCD);
+    trace.Record(Kind::kFrameTime, 1ull << 40, 0, {}, 12345);
+    trace.Record(Kind::kBreak, (1ull << 40) + 1, 0);
+
+    auto const events = Decode(trace.data(), trace.size());
+    ASSERT_EQ(events.size(), 7u);
+    EXPECT_EQ(events[0].kind, Kind::kReset);
+    EXPECT_EQ(events[0].value, 300u);
+    EXPECT_EQ(events[1].value, 3u);
+    EXPECT_EQ(events[2].kind, Kind::kSend);
+    EXPECT_EQ(events[2].time, 7u);
+    EXPECT_EQ(events[2].player, 299);
+    EXPECT_EQ(events[2].data, 0xAB);
+    EXPECT_EQ(events[3].kind, Kind::kRecv);
+    EXPECT_EQ(events[3].time, 1ull << 40);
+    EXPECT_EQ(events[3].player, 14);
+    EXPECT_EQ(events[4].kind, Kind::kSendRejected);
+    EXPECT_EQ(events[4].player, 15);
+    EXPECT_EQ(events[4].data, 0xCD);
+    EXPECT_EQ(events[5].value, 12345u);
+    EXPECT_EQ(events[6].kind, Kind::kBreak);
+    EXPECT_EQ(events[6].time, (1ull << 40) + 1);
+}
+
+TEST(ComLynxTraceTest, test_compact) {
+    ComLynxTraceWriter trace;
+    for (int i = 0; i < 1000; ++i) {
+        trace.Record(ComLynxTrace::Kind::kSend, 0, i % 8, UBYTE(i));
+    }
+    EXPECT_EQ(trace.size(), ComLynxTrace::kHeaderSize + 2 * 1000);
+}
+
+TEST(ComLynxTraceTest, test_replay_slime_world) {
+    ComLynx original(2);
+    ComLynxTraceWriter trace;
+    RecordSlimeWorld(original, trace);
+
+    ComLynx replayed(5);
+    ComLynxTraceReader reader(trace.data(), trace.size());
+    size_t events = 0;
+    EXPECT_TRUE(ReplayComLynxTrace(reader, replayed, events));
+    EXPECT_EQ(events, 1 + 1 + 9 + 7 + 5 + 7 + 1u);
+    EXPECT_EQ(replayed.GetPlayerCount(), 2);
+    EXPECT_EQ(replayed.Now(), original.Now());
+    for (ComLynx::Player p = 0; p < 2; ++p) {
+        EXPECT_EQ(replayed.GetSERCTL(p), original.GetSERCTL(p));
+    }
+}
+
+TEST(ComLynxTraceTest, test_replay_detects_divergence) {
+    using Kind = ComLynxTrace::Kind;
+    ComLynxTraceWriter trace;
+    trace.Record(Kind::kReset, 0, 0, {}, 2);
+    trace.Record(Kind::kConfigure, 0, 0, {}, 1);
+    trace.Record(Kind::kSend, 0, 0, 'A');
+    trace.Record(Kind::kRecv, 0, 1, 'B');
+    trace.Record(Kind::kBreak, 0, 0);
+
+    ComLynx comlynx(2);
+    ComLynxTraceReader reader(trace.data(), trace.size());
+    size_t events = 0;
+    EXPECT_FALSE(ReplayComLynxTrace(reader, comlynx, events));
+    EXPECT_EQ(events, 3u);
+}
+
+TEST(ComLynxTraceTest, test_replay_rejects_foreign_players) {
+    using Kind = ComLynxTrace::Kind;
+    using Control = ComLynxTrace::Control;
+    size_t events = 0;
+
+    ComLynxTraceWriter too_many;
+    too_many.Record(Kind::kReset, 0, 0, {}, ComLynx::kMaxPlayers + 1);
+    ComLynx comlynx(2);
+    ComLynxTraceReader reader(too_many.data(), too_many.size());
+    EXPECT_FALSE(ReplayComLynxTrace(reader, comlynx, events));
+    EXPECT_EQ(events, 0u);
+    EXPECT_EQ(comlynx.GetPlayerCount(), 2);
+
+    for (Kind kind : {Kind::kSend, Kind::kRecv, Kind::kControl}) {
+        ComLynxTraceWriter trace;
+        trace.Record(Kind::kReset, 0, 0, {}, 2);
+        trace.Record(Kind::kConfigure, 0, 0, {}, 1);
+        trace.Record(kind, 0, 40,
+                     static_cast<UBYTE>(Control::kResetErrors));
+        ComLynxTraceReader foreign(trace.data(), trace.size());
+        EXPECT_FALSE(ReplayComLynxTrace(foreign, comlynx, events));
+        EXPECT_EQ(events, 2u);
+    }
+}
+
+TEST(ComLynxTraceTest, test_replay_irq_enables_and_errors) {
+    ComLynx original(2);
+    ComLynxTraceWriter trace;
+    ComLynxRecorder recorder(original, trace);
+    recorder.Configure(ComLynx::ParityConfig::kOdd);
+    recorder.EnableRxIRQ(1, true);
+    recorder.EnableTxIRQ(0, true);
+    for (int i = 0; i < 33; ++i) recorder.Send(0, UBYTE(i));  // overrun
+    recorder.SendBreak();
+    EXPECT_TRUE(recorder.IsRxBrk(1));
+    EXPECT_FALSE(recorder.IsRxBrk(1));
+    recorder.ResetErrors(0);
+    recorder.EnableTxIRQ(0, false);
+
+    ComLynx replayed(2);
+    ComLynxTraceReader reader(trace.data(), trace.size());
+    size_t events = 0;
+    EXPECT_TRUE(ReplayComLynxTrace(reader, replayed, events));
+    EXPECT_EQ(events, 1 + 1 + 2 + 33 + 1 + 1 + 1 + 1u);
+    for (ComLynx::Player p = 0; p < 2; ++p) {
+        EXPECT_EQ(replayed.GetSERCTL(p), original.GetSERCTL(p));
+        EXPECT_EQ(replayed.IsIRQ(p), original.IsIRQ(p));
+    }
+}
+
+TEST(ComLynxTraceTest, test_replay_bursts) {
+    ComLynx original(2);
+    ComLynxTraceWriter trace;
+    ComLynxRecorder recorder(original, trace);
+    recorder.Configure(ComLynx::ParityConfig::kOdd);
+    ComLynxRecorderClient L1(recorder, 0);
+    ComLynxRecorderClient L2(recorder, 1);
+
+    std::vector<UBYTE> packet(40, 0x5A);  // 8 bytes too many
+    EXPECT_EQ(L1.SendBurst(packet.data(), packet.size()), 32u);
+    UBYTE bytes[ComLynx::kBufferSize];
+    auto const generation = L2.GetGeneration();
+    EXPECT_EQ(L2.RecvAvailable(bytes, 20), 20u);
+    EXPECT_GT(L2.GetGeneration(), generation);
+
+    ComLynx replayed(2);
+    ComLynxTraceReader reader(trace.data(), trace.size());
+    size_t events = 0;
+    EXPECT_TRUE(ReplayComLynxTrace(reader, replayed, events));
+    EXPECT_EQ(events, 1 + 1 + 40 + 20u);
+    for (ComLynx::Player p = 0; p < 2; ++p) {
+        EXPECT_EQ(replayed.GetSERCTL(p), original.GetSERCTL(p));
+    }
+}
+
+TEST(ComLynxTraceTest, test_time_going_back) {
+    ComLynx original(2);
+    ComLynxTraceWriter trace;
+    ComLynxRecorder recorder(original, trace);
+    recorder.Configure(ComLynx::ParityConfig::kOdd);
+
+    // Roll back to a snapshot taken before the first send.
+    ComLynx::SavedState state;
+    original.Snapshot(state);
+    recorder.SetTime(100);
+    recorder.Send(0, 'A');
+    original.Restore(state);
+    recorder.Send(0, 'B');
+
+    ComLynxTraceReader reader(trace.data(), trace.size());
+    std::vector<ComLynxTrace::Event> events;
+    ComLynxTrace::Event event;
+    while (reader.Next(event)) events.push_back(event);
+    EXPECT_TRUE(reader.IsValid());
+    ASSERT_EQ(events.size(), 5u);
+    EXPECT_EQ(events[2].time, 100u);
+    EXPECT_EQ(events[3].kind, ComLynxTrace::Kind::kControl);
+    EXPECT_EQ(events[3].data, UBYTE(ComLynxTrace::Control::kRewind));
+    EXPECT_EQ(events[3].time, 0u);
+    EXPECT_EQ(events[4].time, 0u);
+    EXPECT_EQ(events[4].data, 'B');
+
+    ComLynx replayed(2);
+    ComLynxTraceReader replay(trace.data(), trace.size());
+    size_t replayed_events = 0;
+    EXPECT_TRUE(ReplayComLynxTrace(replay, replayed, replayed_events));
+    EXPECT_EQ(replayed.Now(), 0u);
+}
+
+TEST(ComLynxTraceTest, test_rejects_damaged_traces) {
+    ComLynxTraceWriter trace;
+    trace.Record(ComLynxTrace::Kind::kReset, 0, 0, {}, 1000);
+
+    std::vector<UBYTE> bytes(trace.data(), trace.data() + trace.size());
+    bytes[0] = 'X';
+    ComLynxTraceReader bad_magic(bytes.data(), bytes.size());
+    EXPECT_FALSE(bad_magic.IsValid());
+
+    bytes[0] = 'C';
+    bytes.pop_back();
+    ComLynxTraceReader cut_off(bytes.data(), bytes.size());
+    ComLynxTrace::Event event;
+    EXPECT_FALSE(cut_off.Next(event));
+    EXPECT_FALSE(cut_off.IsValid());
+}
+
+#ifdef COMLYNX_HAS_MMAP
+TEST(ComLynxTraceTest, test_replay_from_mapped_file) {
+    ComLynx original(2);
+    ComLynxTraceWriter trace;
+    RecordSlimeWorld(original, trace);
+
+    char path[] = "/tmp/comlynx_traceXXXXXX";
+    auto const fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    auto *file = fdopen(fd, "wb");
+    ASSERT_TRUE(trace.Flush(file));
+    std::fclose(file);
+    EXPECT_EQ(trace.size(), 0u);
+
+    {
+        ComLynxTraceMapping mapping(path);
+        ASSERT_TRUE(mapping.IsOpen());
+        auto reader = mapping.Reader();
+        ComLynx replayed(2);
+        size_t events = 0;
+        EXPECT_TRUE(ReplayComLynxTrace(reader, replayed, events));
+        EXPECT_EQ(replayed.GetSERCTL(0), original.GetSERCTL(0));
+    }
+    std::remove(path);
+}
+#endif  // COMLYNX_HAS_MMAP
@@ -0,0 +1,317 @@
+// You are free to use this in any way you like, as long as you mention:
+// ------------------------------------------------------------------------------
+// Copyright (c) 2024 superKoder (github.com/superKoder/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The ABOVE COPYRIGHT notice and this permission notice SHALL BE INCLUDED in
+// all copies or substantial portions of the Software.
+//
+// The software is provided "as is", without warranty of any kind, express or
+// implied, including but not limited to the warranties of merchantability,
+// fitness for a particular purpose and noninfringement. In no event shall the
+// authors or copyright holders be liable for any claim, damages or other
+// liability, whether in an action of contract, tort or otherwise, arising from,
+// out of or in connection with the software or the use or other dealings in the
+// software.
+// ------------------------------------------------------------------------------
+
+#ifndef SUPERKODER_COMLYNX_UDP_H
+#define SUPERKODER_COMLYNX_UDP_H
+#pragma once
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#define COMLYNX_HAS_SOCKETS 1
+#endif
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include "comlynx.h"
+
+#ifdef COMLYNX_HAS_SOCKETS
+
+/**
+ * Joins a local ComLynx bus to one on another machine over UDP.
+ *
+ * The link takes one player slot on the local bus and stands in for
+ * everybody on the other side: it reads what the local players send, like any
+ * Lynx on the cable would, and sends what arrives from the remote bus as its
+ * own bytes. Emulators keep using ComLynxClient exactly as before.
+ *
+ * Outgoing bytes are batched: Collect() picks them up from the bus (call it
+ * as often as you like) and EndFrame() sends everything collected in one
+ * datagram, once per emulated frame. Each datagram carries a sequence number;
+ * the receiver drops duplicates and anything older than what it already has.
+ * Breaks travel as a flag on the datagram and come before its bytes, on both
+ * ends: a break waits behind whatever arrived ahead of it.
+ *
+ * A link joins exactly two buses. To link more machines, connect them in a
+ * star or a chain, as each link forwards everything its bus carries.
+ */
+class ComLynxUdpLink {
+ public:
+  using Player = ComLynx::Player;
+
+  /// Largest payload in one datagram; a frame with more is split.
+  static constexpr size_t kMaxBatch = 512;
+
+  /// Most received bytes held back while the local cable is full; datagrams
+  /// that would go past it are dropped.
+  static constexpr size_t kMaxInbound = 4 * kMaxBatch;
+
+  /// Bytes before the payload: magic, flags, sequence (LE32), count (LE16).
+  static constexpr size_t kHeaderSize = 9;
+
+  static constexpr UBYTE kMagic[2] = {'C', 'L'};
+  static constexpr UBYTE kBreakFlag = 0x01;
+
+  /// Takes `proxy` on `bus` and binds UDP `local_port` on 127.0.0.1 (or on
+  /// `local_address`). Port 0 picks a free one; see GetLocalPort().
+  inline ComLynxUdpLink(ComLynx &bus, Player proxy, uint16_t local_port,
+                        char const *local_address = "127.0.0.1")
+      : bus_{bus}
+      , proxy_{proxy} {
+    outgoing_.reserve(kMaxBatch);
+    inbound_.reserve(kMaxInbound);
+
+    fd_ = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd_ < 0) return;
+    ::fcntl(fd_, F_SETFL, ::fcntl(fd_, F_GETFL) | O_NONBLOCK);
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(local_port);
+    if (::inet_pton(AF_INET, local_address, &address.sin_addr) != 1 ||
+        ::bind(fd_, reinterpret_cast<sockaddr *>(&address), sizeof(address))) {
+      Close();
+    }
+  }
+
+  ComLynxUdpLink(ComLynxUdpLink const &) = delete;
+  ComLynxUdpLink &operator=(ComLynxUdpLink const &) = delete;
+
+  inline ~ComLynxUdpLink() {
+    Close();
+  }
+
+  constexpr inline bool IsOpen() const {
+    return fd_ >= 0;
+  }
+
+  inline uint16_t GetLocalPort() const {
+    sockaddr_in address = {};
+    socklen_t length = sizeof(address);
+    if (!IsOpen() ||
+        ::getsockname(fd_, reinterpret_cast<sockaddr *>(&address), &length)) {
+      return 0;
+    }
+    return ntohs(address.sin_port);
+  }
+
+  /// Sends to, and only accepts datagrams from, `address`:`port`.
+  inline bool Connect(char const *address, uint16_t port) {
+    if (!IsOpen()) return false;
+    sockaddr_in remote = {};
+    remote.sin_family = AF_INET;
+    remote.sin_port = htons(port);
+    if (::inet_pton(AF_INET, address, &remote.sin_addr) != 1) return false;
+    return ::connect(fd_, reinterpret_cast<sockaddr *>(&remote),
+                     sizeof(remote)) == 0;
+  }
+
+  /// Picks up what the local players have sent since the last call.
+  inline void Collect() {
+    if (bus_.IsRxBrk(proxy_)) {
+      QueueBreak();
+    }
+    while (bus_.IsRxReady(proxy_)) {
+      if (outgoing_.size() == kMaxBatch) {
+        Flush();
+      }
+      outgoing_.push_back(bus_.Recv(proxy_));
+    }
+  }
+
+  /// Collects, then sends this frame's bytes as one datagram (if any).
+  inline bool EndFrame() {
+    Collect();
+    return Flush();
+  }
+
+  /**
+   * Takes in what has arrived, waiting up to `timeout_ms` for the first
+   * datagram, and puts as much of it on the local bus as fits. Bytes that
+   * do not fit yet stay queued for the next call. Returns how many bytes
+   * went onto the bus.
+   */
+  inline size_t Poll(int timeout_ms = 0) {
+    if (!IsOpen()) return 0;
+
+    if (timeout_ms > 0 && inbound_.empty()) {
+      pollfd request = {fd_, POLLIN, 0};
+      ::poll(&request, 1, timeout_ms);
+    }
+    std::array<UBYTE, kHeaderSize + kMaxBatch> datagram;
+    for (;;) {
+      auto const length = ::recv(fd_, datagram.data(), datagram.size(), 0);
+      if (length < 0) break;
+      Receive(datagram.data(), static_cast<size_t>(length));
+    }
+    return Deliver();
+  }
+
+  /// Datagrams the socket took so far.
+  constexpr inline uint32_t GetSentCount() const {
+    return sent_;
+  }
+
+  constexpr inline uint32_t GetReceivedCount() const {
+    return received_;
+  }
+
+  /// Datagrams that arrived damaged, twice, after a newer one, or while
+  /// kMaxInbound bytes were already waiting for the cable.
+  constexpr inline uint32_t GetDroppedCount() const {
+    return dropped_;
+  }
+
+  /// Datagrams that never arrived, judging by gaps in the sequence.
+  constexpr inline uint32_t GetLostCount() const {
+    return lost_;
+  }
+
+ private:
+  ComLynx &bus_;
+  Player const proxy_;
+  int fd_ = -1;
+
+  std::vector<UBYTE> outgoing_;
+  bool send_break_ = false;
+  uint32_t next_sequence_ = {};
+  uint32_t sent_ = {};
+
+  /// Received bytes, with kBreakMarker where a break goes.
+  std::vector<uint16_t> inbound_;
+  size_t inbound_read_ = {};
+  bool has_sequence_ = false;
+  uint32_t last_sequence_ = {};
+  uint32_t received_ = {};
+  uint32_t dropped_ = {};
+  uint32_t lost_ = {};
+
+  static constexpr uint16_t kBreakMarker = 0x100;
+
+  inline void Close() {
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+  }
+
+  /// The flag goes on the next datagram, so send what came before it first.
+  inline void QueueBreak() {
+    if (!outgoing_.empty()) Flush();
+    send_break_ = true;
+  }
+
+  inline bool Flush() {
+    if (outgoing_.empty() && !send_break_) return true;
+
+    std::array<UBYTE, kHeaderSize + kMaxBatch> datagram;
+    auto const sequence = next_sequence_++;
+    auto const count = outgoing_.size();
+    datagram[0] = kMagic[0];
+    datagram[1] = kMagic[1];
+    datagram[2] = send_break_ ? kBreakFlag : 0;
+    datagram[3] = UBYTE(sequence);
+    datagram[4] = UBYTE(sequence >> 8);
+    datagram[5] = UBYTE(sequence >> 16);
+    datagram[6] = UBYTE(sequence >> 24);
+    datagram[7] = UBYTE(count);
+    datagram[8] = UBYTE(count >> 8);
+    std::copy(outgoing_.begin(), outgoing_.end(), &datagram[kHeaderSize]);
+
+    outgoing_.clear();
+    send_break_ = false;
+    if (!IsOpen() || ::send(fd_, datagram.data(), kHeaderSize + count, 0) !=
+                         static_cast<ssize_t>(kHeaderSize + count)) {
+      return false;
+    }
+    ++sent_;
+    return true;
+  }
+
+  inline void Receive(UBYTE const *datagram, size_t length) {
+    if (length < kHeaderSize || datagram[0] != kMagic[0] ||
+        datagram[1] != kMagic[1]) {
+      ++dropped_;
+      return;
+    }
+    auto const sequence = uint32_t{datagram[3]} | uint32_t{datagram[4]} << 8 |
+                          uint32_t{datagram[5]} << 16 |
+                          uint32_t{datagram[6]} << 24;
+    auto const count = size_t{datagram[7]} | size_t{datagram[8]} << 8;
+    if (length != kHeaderSize + count ||
+        (has_sequence_ &&
+         static_cast<int32_t>(sequence - last_sequence_) <= 0)) {
+      ++dropped_;
+      return;
+    }
+    lost_ += has_sequence_ ? sequence - last_sequence_ - 1 : sequence;
+    has_sequence_ = true;
+    last_sequence_ = sequence;
+    auto const rx_break = (datagram[2] & kBreakFlag) != 0;
+    if (inbound_.size() - inbound_read_ + count + rx_break > kMaxInbound) {
+      ++dropped_;
+      return;
+    }
+    ++received_;
+
+    if (rx_break) inbound_.push_back(kBreakMarker);
+    inbound_.insert(inbound_.end(), datagram + kHeaderSize,
+                    datagram + kHeaderSize + count);
+  }
+
+  inline size_t Deliver() {
+    size_t delivered = 0;
+    while (inbound_read_ < inbound_.size()) {
+      auto const entry = inbound_[inbound_read_];
+      if (entry == kBreakMarker) {
+        DeliverBreak();
+        ++inbound_read_;
+        continue;
+      }
+      // Wait for room rather than overrun the proxy; the rest goes next time.
+      if (bus_.GetQueuedCount() >= ComLynx::kBufferSize) break;
+      bus_.Send(proxy_, static_cast<UBYTE>(entry));
+      ++inbound_read_;
+      ++delivered;
+    }
+    inbound_.erase(inbound_.begin(),
+                   inbound_.begin() + static_cast<ptrdiff_t>(inbound_read_));
+    inbound_read_ = 0;
+    return delivered;
+  }
+
+  inline void DeliverBreak() {
+    // A local break Collect() has not picked up yet still has to go out.
+    if (bus_.IsRxBrk(proxy_)) QueueBreak();
+    bus_.SendBreak();
+    // Don't bounce this one back to where it came from.
+    bus_.IsRxBrk(proxy_);
+  }
+};
+#endif  // COMLYNX_HAS_SOCKETS
+
+#endif  // SUPERKODER_COMLYNX_UDP_H
@@ -0,0 +1,303 @@
+// You are free to use this in any way you like, as long as you mention:
+// ------------------------------------------------------------------------------ 
+// Copyright (c) 2024 superKoder (github.com/superKoder/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The ABOVE COPYRIGHT notice and this permission notice SHALL BE INCLUDED in all
+// copies or substantial portions of the Software.
+//
+// The software is provided "as is", without warranty of any kind, express or
+// implied, including but not limited to the warranties of merchantability,
+// fitness for a particular purpose and noninfringement. In no event shall the
+// authors or copyright holders be liable for any claim, damages or other
+// liability, whether in an action of contract, tort or otherwise, arising from,
+// out of or in connection with the software or the use or other dealings in the
+// software.
+// ------------------------------------------------------------------------------ 
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <vector>
+
+using ::testing::ElementsAre;
+
+#include "comlynx_udp.h"
+
+namespace {
+
+constexpr ComLynx::Player kLocal = 0;
+constexpr ComLynx::Player kProxy = 1;
+constexpr int kTimeoutMs = 2000;
+
+/// Two machines, each with one Lynx and a link to the other, over loopback.
+struct TwoMachines {
+    ComLynx bus1{2};
+    ComLynx bus2{2};
+    ComLynxUdpLink link1{bus1, kProxy, 0};
+    ComLynxUdpLink link2{bus2, kProxy, 0};
+    ComLynxClient L1{bus1, kLocal};
+    ComLynxClient L2{bus2, kLocal};
+
+    TwoMachines() {
+        bus1.Configure(ComLynx::ParityConfig::kOdd);
+        bus2.Configure(ComLynx::ParityConfig::kOdd);
+        EXPECT_TRUE(link1.IsOpen());
+        EXPECT_TRUE(link2.IsOpen());
+        EXPECT_TRUE(link1.Connect("127.0.0.1", link2.GetLocalPort()));
+        EXPECT_TRUE(link2.Connect("127.0.0.1", link1.GetLocalPort()));
+    }
+};
+
+std::vector<UBYTE> ReadAll(ComLynxClient &client) {
+    std::vector<UBYTE> ret;
+    while (client.IsRxReady()) {
+        ret.push_back(client.Recv());
+    }
+    return ret;
+}
+
+}  // namespace
+
+TEST(ComLynxUdpLinkTest, test_handshake_slime_world) {
+    TwoMachines m;
+
+    // One emulated frame on each side per step.
+    for (UBYTE byte : {0x05, 0x00, 0x00, 0x01, 0x05, 0x00, 0xF4}) {
+        EXPECT_TRUE(m.L1.Send(byte));
+    }
+    EXPECT_FALSE(m.L1.IsTxEmpty());
+    EXPECT_TRUE(m.link1.EndFrame());
+    EXPECT_TRUE(m.L1.IsTxEmpty());
+
+    EXPECT_EQ(m.link2.Poll(kTimeoutMs), 7u);
+    EXPECT_THAT(ReadAll(m.L2),
+                ElementsAre(0x05, 0x00, 0x00, 0x01, 0x05, 0x00, 0xF4));
+    EXPECT_TRUE(m.link2.EndFrame());
+
+    for (UBYTE byte : {0x05, 0x00, 0x01, 0x03, 0x05, 0x00, 0xF1}) {
+        EXPECT_TRUE(m.L2.Send(byte));
+    }
+    EXPECT_TRUE(m.link2.EndFrame());
+    EXPECT_EQ(m.link1.Poll(kTimeoutMs), 7u);
+    EXPECT_THAT(ReadAll(m.L1),
+                ElementsAre(0x05, 0x00, 0x01, 0x03, 0x05, 0x00, 0xF1));
+
+    // One datagram per frame, and nothing sent for a quiet frame.
+    EXPECT_EQ(m.link1.GetSentCount(), 1u);
+    EXPECT_EQ(m.link2.GetSentCount(), 1u);
+    EXPECT_EQ(m.link1.GetReceivedCount(), 1u);
+    EXPECT_EQ(m.link2.GetReceivedCount(), 1u);
+    EXPECT_EQ(m.link1.GetLostCount(), 0u);
+}
+
+TEST(ComLynxUdpLinkTest, test_break_crosses_once) {
+    TwoMachines m;
+
+    m.L1.SendBreak();
+    EXPECT_TRUE(m.link1.EndFrame());
+    m.link2.Poll(kTimeoutMs);
+    EXPECT_TRUE(m.L2.IsRxBrk());
+
+    // Machine 2 must not send it back.
+    EXPECT_TRUE(m.link2.EndFrame());
+    EXPECT_EQ(m.link2.GetSentCount(), 0u);
+}
+
+TEST(ComLynxUdpLinkTest, test_more_than_fits_on_the_cable) {
+    TwoMachines m;
+
+    // Three frames' worth arrive at once; the remote cable takes 32 at a time.
+    UBYTE next = 0;
+    for (int frame = 0; frame < 3; ++frame) {
+        for (size_t i = 0; i < ComLynx::kBufferSize; ++i) {
+            EXPECT_TRUE(m.L1.Send(next++));
+        }
+        EXPECT_TRUE(m.link1.EndFrame());
+    }
+
+    std::vector<UBYTE> received;
+    EXPECT_EQ(m.link2.Poll(kTimeoutMs), ComLynx::kBufferSize);
+    for (int attempt = 0; attempt < 100 && received.size() < 3 * 32; ++attempt) {
+        auto const bytes = ReadAll(m.L2);
+        received.insert(received.end(), bytes.begin(), bytes.end());
+        m.link2.Poll(10);
+    }
+    ASSERT_EQ(received.size(), 3 * ComLynx::kBufferSize);
+    for (size_t i = 0; i < received.size(); ++i) {
+        EXPECT_EQ(received[i], UBYTE(i));
+    }
+    EXPECT_FALSE(m.L2.HasAnyError());
+}
+
+TEST(ComLynxUdpLinkTest, test_full_cable_leaves_proxy_errors_alone) {
+    TwoMachines m;
+
+    // The proxy reads a byte sent before the parity changed: a real error.
+    EXPECT_TRUE(m.L2.Send(0x01));
+    m.bus2.Configure(ComLynx::ParityConfig::kEven);
+    EXPECT_TRUE(m.link2.EndFrame());
+    EXPECT_TRUE(m.bus2.HasParityError(kProxy));
+
+    // Machine 2's cable is full when machine 1's byte arrives.
+    for (size_t i = 0; i < ComLynx::kBufferSize; ++i) {
+        EXPECT_TRUE(m.L2.Send(UBYTE(i)));
+    }
+    EXPECT_TRUE(m.L1.Send(0x42));
+    EXPECT_TRUE(m.link1.EndFrame());
+    EXPECT_EQ(m.link2.Poll(kTimeoutMs), 0u);
+    EXPECT_TRUE(m.bus2.HasParityError(kProxy));
+    EXPECT_FALSE(m.bus2.HasOverrunError(kProxy));
+
+    EXPECT_TRUE(m.link2.EndFrame());
+    EXPECT_EQ(m.link2.Poll(), 1u);
+    EXPECT_THAT(ReadAll(m.L2), ElementsAre(0x42));
+}
+
+TEST(ComLynxUdpLinkTest, test_counts_only_datagrams_sent) {
+    ComLynx bus(2);
+    bus.Configure(ComLynx::ParityConfig::kOdd);
+    ComLynxUdpLink link(bus, kProxy, 0);
+    ASSERT_TRUE(link.IsOpen());
+    ComLynxClient L1(bus, kLocal);
+
+    // Nowhere to send it to yet.
+    EXPECT_TRUE(L1.Send(0x42));
+    EXPECT_FALSE(link.EndFrame());
+    EXPECT_EQ(link.GetSentCount(), 0u);
+}
+
+TEST(ComLynxUdpLinkTest, test_drops_stale_and_foreign_datagrams) {
+    ComLynx bus(2);
+    bus.Configure(ComLynx::ParityConfig::kOdd);
+    ComLynxUdpLink link(bus, kProxy, 0);
+    ASSERT_TRUE(link.IsOpen());
+
+    auto const fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE(fd, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(link.GetLocalPort());
+    ::inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+    ASSERT_EQ(::connect(fd, reinterpret_cast<sockaddr *>(&address),
+                        sizeof(address)),
+              0);
+
+    auto const send = [fd](std::vector<UBYTE> const &datagram) {
+        ::send(fd, datagram.data(), datagram.size(), 0);
+    };
+    send({'C', 'L', 0, 5, 0, 0, 0, 1, 0, 'A'});  // seq 5
+    send({'C', 'L', 0, 5, 0, 0, 0, 1, 0, 'B'});  // seq 5 again
+    send({'C', 'L', 0, 3, 0, 0, 0, 1, 0, 'C'});  // seq 3, too late
+    send({'X', 'Y', 0, 9, 0, 0, 0, 1, 0, 'D'});  // not ours
+    send({'C', 'L', 0, 9, 0, 0, 0, 2, 0, 'E'});  // cut short
+    send({'C', 'L', 0, 7, 0, 0, 0, 1, 0, 'F'});  // seq 7, 6 lost
+    ::close(fd);
+
+    size_t delivered = 0;
+    for (int attempt = 0; attempt < 10 && delivered < 2; ++attempt) {
+        delivered += link.Poll(kTimeoutMs);
+    }
+    EXPECT_EQ(delivered, 2u);
+    std::vector<UBYTE> received;
+    while (bus.IsRxReady(kLocal)) received.push_back(bus.Recv(kLocal));
+    EXPECT_THAT(received, ElementsAre('A', 'F'));
+    EXPECT_EQ(link.GetReceivedCount(), 2u);
+    EXPECT_EQ(link.GetDroppedCount(), 4u);
+    EXPECT_EQ(link.GetLostCount(), 5u + 1u);
+}
+
+TEST(ComLynxUdpLinkTest, test_caps_what_waits_for_the_cable) {
+    ComLynx bus(2);
+    bus.Configure(ComLynx::ParityConfig::kOdd);
+    ComLynxUdpLink link(bus, kProxy, 0);
+    ASSERT_TRUE(link.IsOpen());
+
+    // Anyone can send to an unconnected link; nobody reads the local cable.
+    auto const fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE(fd, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(link.GetLocalPort());
+    ::inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+    ASSERT_EQ(::connect(fd, reinterpret_cast<sockaddr *>(&address),
+                        sizeof(address)),
+              0);
+    auto const n_datagrams = 2 * ComLynxUdpLink::kMaxInbound /
+                             ComLynxUdpLink::kMaxBatch;
+    for (uint32_t sequence = 0; sequence < n_datagrams; ++sequence) {
+        std::vector<UBYTE> datagram = {'C', 'L', 0, UBYTE(sequence), 0, 0, 0,
+                                       0, ComLynxUdpLink::kMaxBatch >> 8};
+        datagram.resize(ComLynxUdpLink::kHeaderSize + ComLynxUdpLink::kMaxBatch,
+                        UBYTE(sequence));
+        ASSERT_EQ(::send(fd, datagram.data(), datagram.size(), 0),
+                  ssize_t(datagram.size()));
+    }
+    ::close(fd);
+
+    EXPECT_EQ(link.Poll(kTimeoutMs), ComLynx::kBufferSize);
+    for (int attempt = 0; attempt < 10; ++attempt) link.Poll(10);
+    EXPECT_EQ(link.GetReceivedCount() + link.GetDroppedCount(), n_datagrams);
+    EXPECT_EQ(link.GetReceivedCount(),
+              ComLynxUdpLink::kMaxInbound / ComLynxUdpLink::kMaxBatch);
+
+    // What was taken in still arrives, in order, once the cable is read.
+    size_t received = 0;
+    for (int attempt = 0; attempt < 1000 && bus.IsRxReady(kLocal); ++attempt) {
+        while (bus.IsRxReady(kLocal)) {
+            EXPECT_EQ(bus.Recv(kLocal),
+                      UBYTE(received / ComLynxUdpLink::kMaxBatch));
+            ++received;
+        }
+        link.Poll();
+    }
+    EXPECT_EQ(received, ComLynxUdpLink::kMaxInbound);
+}
+
+TEST(ComLynxUdpLinkTest, test_break_keeps_its_place) {
+    TwoMachines m;
+
+    // 40 bytes in two frames, then a break; machine 2's cable takes 32.
+    for (size_t i = 0; i < ComLynx::kBufferSize + 8; ++i) {
+        EXPECT_TRUE(m.L1.Send(UBYTE(i)));
+        if (i + 1 == ComLynx::kBufferSize) {
+            EXPECT_TRUE(m.link1.EndFrame());
+        }
+    }
+    EXPECT_TRUE(m.link1.EndFrame());
+    m.L1.SendBreak();
+    EXPECT_TRUE(m.L1.IsRxBrk());  // its own, as on a real cable
+    EXPECT_TRUE(m.link1.EndFrame());
+
+    // Machine 2 sends a break of its own before its link has looked.
+    m.L2.SendBreak();
+    EXPECT_TRUE(m.L2.IsRxBrk());
+
+    size_t delivered = 0;
+    for (int attempt = 0; attempt < 10 && delivered < ComLynx::kBufferSize;
+         ++attempt) {
+        delivered += m.link2.Poll(kTimeoutMs);
+    }
+    EXPECT_EQ(delivered, ComLynx::kBufferSize);
+    EXPECT_FALSE(m.L2.IsRxBrk());  // still behind the last 8 bytes
+    EXPECT_EQ(ReadAll(m.L2).size(), ComLynx::kBufferSize);
+    EXPECT_EQ(m.link2.Poll(), 8u);
+    EXPECT_TRUE(m.L2.IsRxBrk());
+    EXPECT_EQ(ReadAll(m.L2).size(), 8u);
+
+    // Machine 2's own break was not taken for the echo.
+    EXPECT_TRUE(m.link2.EndFrame());
+    m.link1.Poll(kTimeoutMs);
+    EXPECT_TRUE(m.L1.IsRxBrk());
+
+    // And machine 1's does not come back a second time.
+    EXPECT_TRUE(m.link1.EndFrame());
+    EXPECT_EQ(m.link2.Poll(100), 0u);
+    EXPECT_FALSE(m.L2.IsRxBrk());
+}
@@ -0,0 +1,277 @@
+// You are free to use this in any way you like, as long as you mention:
+// ------------------------------------------------------------------------------
+// Copyright (c) 2024 superKoder (github.com/superKoder/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The ABOVE COPYRIGHT notice and this permission notice SHALL BE INCLUDED in
+// all copies or substantial portions of the Software.
+//
+// The software is provided "as is", without warranty of any kind, express or
+// implied, including but not limited to the warranties of merchantability,
+// fitness for a particular purpose and noninfringement. In no event shall the
+// authors or copyright holders be liable for any claim, damages or other
+// liability, whether in an action of contract, tort or otherwise, arising from,
+// out of or in connection with the software or the use or other dealings in the
+// software.
+// ------------------------------------------------------------------------------
+
+#ifndef SUPERKODER_COMLYNX_WIDE_H
+#define SUPERKODER_COMLYNX_WIDE_H
+#pragma once
+
+#include <memory_resource>
+#include <vector>
+
+#include "comlynx.h"
+
+/**
+ * ComLynx for cables with far more players than a real Lynx link, such as
+ * test rigs with hundreds of listen-only spectators and bots.
+ *
+ * Nothing here ever loops over the players: a byte goes out with a single
+ * reader count in its slot, every player keeps its own cursor, and a break is
+ * an epoch number each player compares against. Sending therefore costs the
+ * same for 8 or 4000 listeners. In exchange, status is worked out when asked
+ * for instead of being cached, there is no IRQ edge callback, and bytes are
+ * delivered immediately (no frame timing).
+ */
+class WideComLynx : public ComLynxTypes {
+ public:
+  /// Bits used to store who sent a queued byte.
+  static constexpr int kSenderBits = 12;
+  static constexpr Player kMaxPlayers = Player{1} << kSenderBits;
+
+  using Buffer = ComLynxByteQueue<kBufferSize, kSenderBits>;
+  using Index = Buffer::Index;
+
+  inline explicit WideComLynx(
+      Player n_players,
+      std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+      : players_(resource) {
+    Reset(n_players);
+  }
+
+  /// Puts the bus back in its just-constructed state, keeping its memory.
+  inline void Reset(Player n_players) {
+    COMLYNX_ASSERT(n_players >= 0 && n_players <= kMaxPlayers);
+    n_players_ = n_players;
+    configured_ = false;
+    enable_parity_ = {};
+    even_parity_ = {};
+    break_epoch_ = {};
+    buffer_ = {};
+    players_.assign(n_players, {});
+  }
+
+  constexpr inline Player GetPlayerCount() const {
+    return n_players_;
+  }
+
+  constexpr void Configure(bool enable_parity, bool even_parity) {
+    enable_parity_ = enable_parity;
+    even_parity_ = even_parity;
+    configured_ = true;
+  }
+
+  constexpr void Configure(ParityConfig config) {
+    switch (config) {
+      case ParityConfig::kOdd:
+        Configure(true, false);
+        return;
+      case ParityConfig::kEven:
+        Configure(true, true);
+        return;
+      case ParityConfig::kSpace:
+        Configure(false, false);
+        return;
+      case ParityConfig::kMark:
+        Configure(false, true);
+        return;
+    }
+  }
+
+  inline void EnableRxIRQ(Player player, bool value) {
+    COMLYNX_ASSERT(configured_);
+    players_[player].rx_int_en = value;
+  }
+
+  inline void EnableTxIRQ(Player player, bool value) {
+    COMLYNX_ASSERT(configured_);
+    players_[player].tx_int_en = value;
+  }
+
+  inline bool Send(Player player, UBYTE data) {
+    COMLYNX_ASSERT(configured_);
+    TxNotReadyReason reason = TxNotReadyReason::kNone;
+    if (!IsTxReady(player, reason)) {
+      players_[player].errors.overrun = true;
+      return false;
+    }
+
+    buffer_.push_back(player, data, ParityFor(data), {}, {},
+                      static_cast<Buffer::Readers>(n_players_ - 1));
+    SkipOwnMessages(player);
+    FreeRead();
+    return true;
+  }
+
+  inline UBYTE Recv(Player player) {
+    COMLYNX_ASSERT(configured_);
+
+    auto &cursor = players_[player].cursor;
+    COMLYNX_ASSERT(cursor != buffer_.end_index());
+
+    auto const data = buffer_.data(cursor);
+    buffer_.MarkRead(cursor);
+    ++cursor;
+    SkipOwnMessages(player);
+    FreeRead();
+    return data;
+  }
+
+  inline void SendBreak() {
+    COMLYNX_ASSERT(configured_);
+    ++break_epoch_;
+  }
+
+  /// Player can only read when something new is available.
+  inline bool IsRxReady(Player player) {
+    COMLYNX_ASSERT(configured_);
+
+    auto &state = players_[player];
+    if (state.cursor == buffer_.end_index()) {
+      return false;
+    }
+    if (buffer_.parity(state.cursor) !=
+        CalculateParity(even_parity_, buffer_.data(state.cursor))) {
+      state.errors.parity = true;
+    }
+    return true;
+  }
+
+  /// Player can only write after everything has been read.
+  inline bool IsTxReady(Player player, TxNotReadyReason &reason) const {
+    COMLYNX_ASSERT(configured_);
+    if (buffer_.size() >= kBufferSize) {
+      reason = TxNotReadyReason::kOverrun;
+      return false;
+    }
+    return true;
+  }
+
+  inline bool IsTxEmpty(Player player) const {
+    COMLYNX_ASSERT(configured_);
+    return !buffer_.HasFrom(player);
+  }
+
+  inline bool IsRxBrk(Player player) {
+    COMLYNX_ASSERT(configured_);
+    auto &state = players_[player];
+    if (state.break_epoch == break_epoch_) {
+      return false;
+    }
+    state.break_epoch = break_epoch_;
+    return true;
+  }
+
+  inline bool IsIRQ(Player player) {
+    auto const &state = players_[player];
+    if (state.rx_int_en && IsRxReady(player)) {
+      return true;
+    }
+    TxNotReadyReason reason = {};
+    return state.tx_int_en && IsTxReady(player, reason);
+  }
+
+  inline bool HasFrameError(Player player) const {
+    COMLYNX_ASSERT(configured_);
+    return players_[player].errors.frame;
+  }
+
+  inline bool HasOverrunError(Player player) const {
+    COMLYNX_ASSERT(configured_);
+    return players_[player].errors.overrun;
+  }
+
+  inline bool HasParityError(Player player) const {
+    COMLYNX_ASSERT(configured_);
+    return players_[player].errors.parity;
+  }
+
+  inline bool HasAnyError(Player player) const {
+    COMLYNX_ASSERT(configured_);
+    auto const &errors = players_[player].errors;
+    return errors.frame || errors.overrun || errors.parity;
+  }
+
+  inline void ResetErrors(Player player) {
+    COMLYNX_ASSERT(configured_);
+    players_[player].errors.Reset();
+  }
+
+  inline UBYTE GetSERCTL(Player player) {
+    COMLYNX_ASSERT(configured_);
+
+    TxNotReadyReason reason = {};
+    auto const tx_ready = IsTxReady(player, reason);
+    auto const rx_ready = IsRxReady(player);
+    auto const &state = players_[player];
+    auto const &errors = state.errors;
+
+    UBYTE byte = {};
+    byte |= tx_ready ? 0x80 : 0x00;
+    byte |= rx_ready ? 0x40 : 0x00;
+    byte |= IsTxEmpty(player) ? 0x20 : 0x00;
+    byte |= errors.parity ? 0x10 : 0x00;
+    byte |= errors.overrun ? 0x08 : 0x00;
+    byte |= errors.frame ? 0x04 : 0x00;
+    byte |= (state.break_epoch != break_epoch_) ? 0x02 : 0x00;
+    byte |= (rx_ready && ParityFor(buffer_.data(state.cursor))) ? 0x01 : 0x00;
+    return byte;
+  }
+
+ private:
+  struct PlayerState {
+    Index cursor = {};
+    uint32_t break_epoch = {};
+    Error errors = {};
+    bool rx_int_en = {};
+    bool tx_int_en = {};
+  };
+
+  Player n_players_ = {};
+  bool configured_ = false;
+  bool enable_parity_ = {};
+  bool even_parity_ = {};
+  uint32_t break_epoch_ = {};
+  Buffer buffer_;
+  std::pmr::vector<PlayerState> players_;
+
+  constexpr inline bool ParityFor(UBYTE byte) const {
+    return (enable_parity_ ? CalculateParity(even_parity_, byte)
+                           : even_parity_);
+  }
+
+  inline void SkipOwnMessages(Player player) {
+    auto &cursor = players_[player].cursor;
+    while (cursor != buffer_.end_index() && buffer_.sender(cursor) == player) {
+      ++cursor;
+    }
+  }
+
+  inline void FreeRead() {
+    while (!buffer_.empty() && buffer_.readers(buffer_.begin_index()) == 0) {
+      buffer_.pop_front();
+    }
+  }
+};
+
+using WideComLynxClient = BasicComLynxClient<WideComLynx>;
+
+#endif  // SUPERKODER_COMLYNX_WIDE_H
@@ -0,0 +1,102 @@
+// You are free to use this in any way you like, as long as you mention:
+// ------------------------------------------------------------------------------ 
+// Copyright (c) 2024 superKoder (github.com/superKoder/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The ABOVE COPYRIGHT notice and this permission notice SHALL BE INCLUDED in all
+// copies or substantial portions of the Software.
+//
+// The software is provided "as is", without warranty of any kind, express or
+// implied, including but not limited to the warranties of merchantability,
+// fitness for a particular purpose and noninfringement. In no event shall the
+// authors or copyright holders be liable for any claim, damages or other
+// liability, whether in an action of contract, tort or otherwise, arising from,
+// out of or in connection with the software or the use or other dealings in the
+// software.
+// ------------------------------------------------------------------------------ 
+
+#include <gtest/gtest.h>
+
+#include "comlynx_test_random.h"
+#include "comlynx_wide.h"
+
+TEST(WideComLynxTest, test_256p_broadcast) {
+    constexpr ComLynx::Player kPlayers = 256;
+    WideComLynx comlynx(kPlayers);
+    comlynx.Configure(ComLynx::ParityConfig::kOdd);
+
+    for (ComLynx::Player sender : {0, 100, 255}) {
+        for (size_t i = 0; i < WideComLynx::kBufferSize; ++i) {
+            EXPECT_TRUE(comlynx.Send(sender, UBYTE(i)));
+        }
+        EXPECT_FALSE(comlynx.Send(sender, 'X'));
+        EXPECT_TRUE(comlynx.HasOverrunError(sender));
+        comlynx.ResetErrors(sender);
+
+        for (ComLynx::Player p = 0; p < kPlayers; ++p) {
+            if (p == sender) {
+                EXPECT_FALSE(comlynx.IsRxReady(p));
+                continue;
+            }
+            EXPECT_FALSE(comlynx.IsTxEmpty(sender));
+            for (size_t i = 0; i < WideComLynx::kBufferSize; ++i) {
+                ASSERT_TRUE(comlynx.IsRxReady(p));
+                EXPECT_EQ(comlynx.Recv(p), UBYTE(i));
+            }
+            EXPECT_FALSE(comlynx.IsRxReady(p));
+        }
+        EXPECT_TRUE(comlynx.IsTxEmpty(sender));
+        EXPECT_EQ(comlynx.GetSERCTL(sender), 0b10100000);
+    }
+}
+
+TEST(WideComLynxTest, test_break_reaches_everyone_once) {
+    WideComLynx comlynx(1000);
+    comlynx.Configure(ComLynx::ParityConfig::kOdd);
+
+    comlynx.SendBreak();
+    for (ComLynx::Player p = 0; p < 1000; ++p) {
+        EXPECT_EQ(comlynx.GetSERCTL(p) & 0x02, 0x02);
+        EXPECT_TRUE(comlynx.IsRxBrk(p));
+        EXPECT_FALSE(comlynx.IsRxBrk(p));
+    }
+}
+
+TEST(WideComLynxTest, test_matches_comlynx) {
+    ComLynx narrow(ComLynx::kMaxPlayers);
+    WideComLynx wide(ComLynx::kMaxPlayers);
+    narrow.Configure(ComLynx::ParityConfig::kMark);
+    wide.Configure(ComLynx::ParityConfig::kMark);
+
+    ComLynxTestRandom random(4242);
+
+    for (int step = 0; step < 2000; ++step) {
+        auto const p = ComLynx::Player(random(ComLynx::kMaxPlayers));
+        auto const byte = UBYTE(random(256));
+        switch (random(4)) {
+            case 0:
+            case 1:
+                EXPECT_EQ(narrow.Send(p, byte), wide.Send(p, byte));
+                break;
+            case 2:
+                ASSERT_EQ(narrow.IsRxReady(p), wide.IsRxReady(p));
+                if (wide.IsRxReady(p)) {
+                    EXPECT_EQ(narrow.Recv(p), wide.Recv(p));
+                }
+                break;
+            case 3:
+                narrow.ResetErrors(p);
+                wide.ResetErrors(p);
+                break;
+        }
+        for (ComLynx::Player q = 0; q < ComLynx::kMaxPlayers; ++q) {
+            EXPECT_EQ(narrow.GetSERCTL(q), wide.GetSERCTL(q)) << "step " << step;
+        }
+    }
+}